@@ -0,0 +1,851 @@
+// Fleet load generator: N simulated boards against a real MQTT broker, to
+// find where the ingestion pipeline (broker -> mqtt_logger.js -> SQLite ->
+// oauth/api.js) stops keeping up.
+//
+//   pio run -e fleet && .pio/build/fleet/program --devices 500 --duration-s 120
+//
+//   --devices N        simulated boards, each with its own MQTT connection (50)
+//   --duration-s S     run time after the last board connected (60)
+//   --ramp-s S         spread the connects over this long (10)
+//   --motion R         knocks per board per minute (0.6)
+//   --broker HOST:PORT MQTT broker (127.0.0.1:1883)
+//   --api HOST:PORT    API to query with GET /sensors (127.0.0.1:3001)
+//   --query-ms N       pause between /sensors queries; 0 disables them (1000)
+//   --seed N           sensor noise seed (1)
+//
+// Each board runs the firmware's own sample and publish decision over a
+// drifting climate and random knocks: SampleCycle (lib/Sampling) for the
+// adaptive periods, alerts and detectors, and the ReportChannels of
+// TelemetryPolicy.h for a packed frame on devices/<id>/sensor/frame whenever
+// a channel is due. Like the firmware, a quiet board sends about one frame a
+// minute. A board that loses its connection keeps sampling, journals its
+// frames, reconnects with the firmware's MQTT backoff and replays them on
+// sensor/frame/batch at the firmware's pace.
+//
+// Measured:
+//   broker_ms     publish to delivery on a devices/+/sensor/frame subscription
+//   end_to_end_ms publish to the logger's commit of the oldest frame of each
+//                 flush, from the logger/stats message mqtt_logger.js sends
+//   logger rows/s rows committed per second, from the same messages
+//   sensors_ms    GET /sensors response time, grouped by table size
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <array>
+#include <chrono>
+#include <deque>
+#include <errno.h>
+#include <fcntl.h>
+#include <mutex>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include <Backoff.h>
+#include <MqttRouter.h>
+#include <SampleCycle.h>
+#include <TelemetryJournal.h>
+
+#include "TelemetryPolicy.h"
+
+namespace
+{
+  struct Options
+  {
+    uint32_t devices = 50;
+    uint32_t durationS = 60;
+    uint32_t rampS = 10;
+    double motion = 0.6;
+    std::string brokerHost = "127.0.0.1";
+    uint16_t brokerPort = 1883;
+    std::string apiHost = "127.0.0.1";
+    uint16_t apiPort = 3001;
+    uint32_t queryMs = 1000;
+    uint32_t seed = 1;
+  };
+
+  const uint16_t KEEPALIVE_S = 60;
+  const size_t SENT_SLOTS = 64; // send times kept per board, by seq
+  const uint64_t STEP_US = 5000; // the firmware's acquisition step
+  // The 64 KB journal partition (partitions.csv), less the sector the head
+  // reclaims.
+  const size_t JOURNAL_FRAMES = (0x10000 / JOURNAL_SECTOR_SIZE - 1) * (JOURNAL_SECTOR_SIZE / JOURNAL_RECORD_SIZE);
+
+  uint64_t nowUs()
+  {
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+  }
+
+  int connectTcp(const std::string &host, uint16_t port)
+  {
+    addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *result = nullptr;
+    char service[8];
+    snprintf(service, sizeof(service), "%u", port);
+    if (getaddrinfo(host.c_str(), service, &hints, &result) != 0)
+      return -1;
+    int fd = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+    if (fd >= 0 && connect(fd, result->ai_addr, result->ai_addrlen) != 0)
+    {
+      close(fd);
+      fd = -1;
+    }
+    freeaddrinfo(result);
+    if (fd >= 0)
+    {
+      int one = 1;
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return fd;
+  }
+
+  // Minimal MQTT 3.1.1 client, QoS 0 only: enough to publish and subscribe
+  // from many connections in one poll() loop.
+  class MqttConnection
+  {
+  public:
+    ~MqttConnection() { disconnect(); }
+
+    // Blocking connect and CONNACK; the socket is non-blocking afterwards.
+    bool connect(const Options &opt, const char *clientId)
+    {
+      out_.clear(); // whatever was queued for a lost connection
+      outSent_ = 0;
+      in_.clear();
+      fd_ = connectTcp(opt.brokerHost, opt.brokerPort);
+      if (fd_ < 0)
+        return false;
+      std::vector<uint8_t> body = {0, 4, 'M', 'Q', 'T', 'T', 4, 0x02, KEEPALIVE_S >> 8, KEEPALIVE_S & 0xff};
+      appendString(body, clientId);
+      queuePacket(0x10, body);
+      if (!flushBlocking())
+        return false;
+      uint8_t connack[4];
+      timeval timeout = {5, 0};
+      setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+      if (recv(fd_, connack, sizeof(connack), MSG_WAITALL) != 4 || connack[0] != 0x20 || connack[3] != 0)
+      {
+        disconnect();
+        return false;
+      }
+      fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) | O_NONBLOCK);
+      lastSendUs_ = nowUs();
+      return true;
+    }
+
+    void subscribe(const char *filter)
+    {
+      std::vector<uint8_t> body = {0, (uint8_t)++packetId_};
+      appendString(body, filter);
+      body.push_back(0); // QoS 0
+      queuePacket(0x82, body);
+    }
+
+    void publish(const char *topic, const uint8_t *payload, size_t length)
+    {
+      std::vector<uint8_t> body;
+      appendString(body, topic);
+      body.insert(body.end(), payload, payload + length);
+      queuePacket(0x30, body);
+    }
+
+    // Keeps the broker from dropping an idle connection.
+    void keepAlive(uint64_t now)
+    {
+      if (now - lastSendUs_ >= (uint64_t)KEEPALIVE_S * 500000)
+        queuePacket(0xc0, {});
+    }
+
+    bool connected() const { return fd_ >= 0; }
+    int fd() const { return fd_; }
+    bool wantsWrite() const { return out_.size() > outSent_; }
+
+    // Non-blocking write of whatever is queued.
+    void onWritable()
+    {
+      while (fd_ >= 0 && outSent_ < out_.size())
+      {
+        ssize_t n = send(fd_, out_.data() + outSent_, out_.size() - outSent_, MSG_NOSIGNAL);
+        if (n < 0)
+        {
+          if (errno != EAGAIN && errno != EWOULDBLOCK)
+            disconnect();
+          break;
+        }
+        outSent_ += n;
+      }
+      if (outSent_ == out_.size())
+      {
+        out_.clear();
+        outSent_ = 0;
+      }
+    }
+
+    // Reads what arrived and calls onPublish(topic, payload, length) for each
+    // PUBLISH; other packets are consumed silently.
+    template <typename Handler>
+    void onReadable(Handler onPublish)
+    {
+      uint8_t chunk[16384];
+      for (;;)
+      {
+        ssize_t n = recv(fd_, chunk, sizeof(chunk), 0);
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+        {
+          disconnect();
+          return;
+        }
+        if (n < 0)
+          break;
+        in_.insert(in_.end(), chunk, chunk + n);
+      }
+
+      size_t offset = 0;
+      for (;;)
+      {
+        size_t remaining = 0, header = 1;
+        int shift = 0;
+        bool complete = false;
+        while (offset + header < in_.size() && header <= 4)
+        {
+          uint8_t digit = in_[offset + header++];
+          remaining |= (size_t)(digit & 0x7f) << shift;
+          shift += 7;
+          if (!(digit & 0x80))
+          {
+            complete = true;
+            break;
+          }
+        }
+        if (!complete || offset + header + remaining > in_.size())
+          break;
+        const uint8_t *packet = in_.data() + offset + header;
+        if ((in_[offset] & 0xf0) == 0x30 && remaining >= 2)
+        {
+          size_t topicLength = packet[0] << 8 | packet[1];
+          size_t skip = 2 + topicLength + ((in_[offset] & 0x06) ? 2 : 0);
+          if (skip <= remaining)
+          {
+            std::string topic((const char *)packet + 2, topicLength);
+            onPublish(topic, packet + skip, remaining - skip);
+          }
+        }
+        offset += header + remaining;
+      }
+      in_.erase(in_.begin(), in_.begin() + offset);
+    }
+
+    void disconnect()
+    {
+      if (fd_ >= 0)
+        close(fd_);
+      fd_ = -1;
+    }
+
+  private:
+    static void appendString(std::vector<uint8_t> &out, const char *text)
+    {
+      size_t length = strlen(text);
+      out.push_back((uint8_t)(length >> 8));
+      out.push_back((uint8_t)length);
+      out.insert(out.end(), text, text + length);
+    }
+
+    void queuePacket(uint8_t type, const std::vector<uint8_t> &body)
+    {
+      out_.push_back(type);
+      size_t length = body.size();
+      do
+      {
+        uint8_t digit = length & 0x7f;
+        length >>= 7;
+        out_.push_back(length ? digit | 0x80 : digit);
+      } while (length);
+      out_.insert(out_.end(), body.begin(), body.end());
+      lastSendUs_ = nowUs();
+    }
+
+    bool flushBlocking()
+    {
+      while (outSent_ < out_.size())
+      {
+        ssize_t n = send(fd_, out_.data() + outSent_, out_.size() - outSent_, MSG_NOSIGNAL);
+        if (n <= 0)
+        {
+          disconnect();
+          return false;
+        }
+        outSent_ += n;
+      }
+      out_.clear();
+      outSent_ = 0;
+      return true;
+    }
+
+    int fd_ = -1;
+    uint16_t packetId_ = 0;
+    uint64_t lastSendUs_ = 0;
+    std::vector<uint8_t> out_;
+    size_t outSent_ = 0;
+    std::vector<uint8_t> in_;
+  };
+
+  // One simulated board: climate drift and knocks in, frames out.
+  struct Device
+  {
+    char id[13];         // 12 hex digits, like the firmware's MAC-based id
+    char topic[48];      // devices/<id>/sensor/frame
+    char batchTopic[56]; // devices/<id>/sensor/frame/batch
+    MqttConnection mqtt;
+    bool booted = false; // powered on; the ramp decides when
+    bool everConnected = false;
+    uint64_t bootUs = 0;
+    uint16_t seq = 0;
+    float temperature = 22.0f;
+    float humidity = 45.0f;
+    uint32_t lastClimateMs = 0;
+    uint32_t windowStartMs = 0;
+    uint64_t nextKnockUs = 0;
+    bool knocked = false; // the open motion window holds a knock
+    DetectorState detectors = {};
+    SampleCycle sampling{CLIMATE_SAMPLING, MOTION_SAMPLING, detectors};
+    ReportChannels report;
+    std::deque<std::array<uint8_t, TELEMETRY_FRAME_SIZE>> journal;
+    uint64_t nextReplayUs = 0;
+    uint64_t nextConnectUs = 0;
+    uint8_t connectAttempts = 0;
+    uint16_t sentSeq[SENT_SLOTS];
+    uint64_t sentUs[SENT_SLOTS] = {};
+  };
+
+  uint64_t nextKnock(const Options &opt, std::mt19937 &rng, uint64_t now)
+  {
+    if (opt.motion <= 0)
+      return UINT64_MAX;
+    return now + (uint64_t)(std::exponential_distribution<double>(opt.motion / 60e6)(rng));
+  }
+
+  // The firmware's acquisitionStep() + publishFrame() for one board: a record
+  // when the climate or motion period is up or a knock closes the window
+  // early, published when a channel is due, journaled while offline.
+  bool sampleStep(Device &d, const Options &opt, std::mt19937 &rng, uint64_t now)
+  {
+    uint32_t deviceMs = (uint32_t)((now - d.bootUs) / 1000);
+    if (now >= d.nextKnockUs)
+    {
+      d.knocked = true;
+      d.nextKnockUs = nextKnock(opt, rng, now);
+    }
+    bool climateDue = d.sampling.climateDue(deviceMs);
+    bool motionBurst = d.knocked && d.sampling.motionEventAllowed(deviceMs);
+    if (!climateDue && !motionBurst && !d.sampling.motionDue(deviceMs))
+      return false;
+
+    float temp = NAN, hum = NAN;
+    if (climateDue)
+    {
+      // a random walk, as drifting over the time since the last reading
+      float scale = sqrtf((deviceMs - d.lastClimateMs) / 5000.0f);
+      std::normal_distribution<float> drift(0.0f, 0.15f * scale);
+      d.temperature += drift(rng);
+      d.humidity = std::min(95.0f, std::max(20.0f, d.humidity + 4 * drift(rng)));
+      d.lastClimateMs = deviceMs;
+      temp = roundf(d.temperature * 10) / 10; // DHT11 resolution
+      hum = roundf(d.humidity);
+    }
+
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+    uint16_t peak = d.knocked ? 18000 + (uint16_t)(chance(rng) * 8000) : 16420;
+    MotionFeatures window = {};
+    window.samples = std::max<uint32_t>(1, (deviceMs - d.windowStartMs) / 2); // 500 Hz
+    window.last = {{(int16_t)(d.knocked ? peak / 2 : 120), -80, (int16_t)(d.knocked ? peak : 16420)}, {}};
+    window.accelPeakMagnitude = peak;
+    window.accelRmsMagnitude = 16420;
+    // |a| with gravity removed: a knock, or sensor noise
+    window.dynamicPeakMagnitude = d.knocked ? peak - 16000 : (uint16_t)(chance(rng) * 200);
+    d.windowStartMs = deviceMs;
+    d.knocked = false;
+
+    TelemetrySample sample = {};
+    d.sampling.update(deviceMs, climateDue, temp, hum, window, sample);
+    for (int axis = 0; axis < 3; axis++)
+      sample.accel[axis] = window.last.accel[axis];
+    if (!d.report.frameDue(sample, deviceMs))
+      return false;
+
+    sample.seq = d.seq++;
+    uint8_t frame[TELEMETRY_FRAME_SIZE];
+    size_t length = encodeTelemetryFrame(sample, frame, sizeof(frame));
+    d.report.framePublished(sample, deviceMs);
+    if (!d.mqtt.connected())
+    {
+      if (d.journal.size() == JOURNAL_FRAMES)
+        d.journal.pop_front(); // the ring overwrites the oldest
+      d.journal.emplace_back();
+      memcpy(d.journal.back().data(), frame, TELEMETRY_FRAME_SIZE);
+      return false;
+    }
+    d.mqtt.publish(d.topic, frame, length);
+    d.sentSeq[sample.seq % SENT_SLOTS] = sample.seq;
+    d.sentUs[sample.seq % SENT_SLOTS] = now;
+    return true;
+  }
+
+  // The firmware's replayJournal(): one batch at a time, never in a step
+  // that published a live frame. Returns the frames sent.
+  size_t replayJournal(Device &d, uint64_t now)
+  {
+    if (d.journal.empty() || now < d.nextReplayUs)
+      return 0;
+    size_t frames = std::min(d.journal.size(), REPLAY_BATCH_FRAMES);
+    uint8_t batch[REPLAY_BATCH_FRAMES * TELEMETRY_FRAME_SIZE];
+    for (size_t i = 0; i < frames; i++)
+      memcpy(batch + i * TELEMETRY_FRAME_SIZE, d.journal[i].data(), TELEMETRY_FRAME_SIZE);
+    d.mqtt.publish(d.batchTopic, batch, frames * TELEMETRY_FRAME_SIZE);
+    d.journal.erase(d.journal.begin(), d.journal.begin() + frames);
+    d.nextReplayUs = now + (uint64_t)REPLAY_INTERVAL_MS * 1000;
+    return frames;
+  }
+
+  // Send time of a board's frame, 0 if unknown or already overwritten.
+  uint64_t sentAt(const std::vector<Device> &devices, const char *id, size_t idLength, uint16_t seq)
+  {
+    if (idLength != 12 || strncmp(id, "02fe", 4) != 0)
+      return 0;
+    unsigned long index = strtoul(std::string(id + 4, 8).c_str(), nullptr, 16);
+    if (index >= devices.size())
+      return 0;
+    const Device &d = devices[index];
+    return d.sentSeq[seq % SENT_SLOTS] == seq ? d.sentUs[seq % SENT_SLOTS] : 0;
+  }
+
+  // Pulls "key":<number> out of a flat JSON object; -1 if absent.
+  long jsonNumber(const char *json, const char *key)
+  {
+    char pattern[32];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    const char *at = strstr(json, pattern);
+    return at && at[strlen(pattern)] != 'n' ? strtol(at + strlen(pattern), nullptr, 10) : -1;
+  }
+
+  // The {"device":"...","seq":N} object under key, if any.
+  bool jsonFrameRef(const char *json, const char *key, std::string &device, uint16_t &seq)
+  {
+    char pattern[32];
+    snprintf(pattern, sizeof(pattern), "\"%s\":{", key);
+    const char *at = strstr(json, pattern);
+    if (!at)
+      return false;
+    const char *id = strstr(at, "\"device\":\"");
+    long value = jsonNumber(at, "seq");
+    if (!id || value < 0)
+      return false;
+    id += 10;
+    const char *end = strchr(id, '"');
+    if (!end)
+      return false;
+    device.assign(id, end - id);
+    seq = (uint16_t)value;
+    return true;
+  }
+
+  struct QuerySample
+  {
+    long rows;
+    double ms;
+  };
+
+  // GET /sensors with a fresh connection each time, as a browser would.
+  double querySensors(const Options &opt, bool &ok)
+  {
+    uint64_t start = nowUs();
+    ok = false;
+    int fd = connectTcp(opt.apiHost, opt.apiPort);
+    if (fd < 0)
+      return 0;
+    char request[128];
+    int length = snprintf(request, sizeof(request), "GET /sensors HTTP/1.1\r\nHost: %s\r\nConnection: close\r\n\r\n",
+                          opt.apiHost.c_str());
+    timeval timeout = {10, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    if (send(fd, request, length, MSG_NOSIGNAL) == length)
+    {
+      char buffer[16384];
+      ssize_t n, total = 0;
+      char status[16] = {};
+      while ((n = recv(fd, buffer, sizeof(buffer), 0)) > 0)
+      {
+        if (total == 0)
+          memcpy(status, buffer, std::min((size_t)n, sizeof(status) - 1));
+        total += n;
+      }
+      ok = n == 0 && strncmp(status + 8, " 200", 4) == 0;
+    }
+    close(fd);
+    return (nowUs() - start) / 1000.0;
+  }
+
+  double percentile(std::vector<double> &values, double p)
+  {
+    if (values.empty())
+      return 0;
+    std::sort(values.begin(), values.end());
+    size_t index = (size_t)(p * (values.size() - 1) + 0.5);
+    return values[index];
+  }
+
+  bool parseHostPort(const char *arg, std::string &host, uint16_t &port)
+  {
+    const char *colon = strrchr(arg, ':');
+    if (!colon)
+      return false;
+    host.assign(arg, colon - arg);
+    port = (uint16_t)atoi(colon + 1);
+    return port != 0;
+  }
+
+  bool parseArgs(int argc, char **argv, Options &opt)
+  {
+    for (int i = 1; i < argc; i++)
+    {
+      const char *arg = argv[i];
+      const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+      if (!value)
+        return false;
+      if (strcmp(arg, "--devices") == 0)
+        opt.devices = (uint32_t)atoi(value);
+      else if (strcmp(arg, "--duration-s") == 0)
+        opt.durationS = (uint32_t)atoi(value);
+      else if (strcmp(arg, "--ramp-s") == 0)
+        opt.rampS = (uint32_t)atoi(value);
+      else if (strcmp(arg, "--motion") == 0)
+        opt.motion = atof(value);
+      else if (strcmp(arg, "--broker") == 0)
+      {
+        if (!parseHostPort(value, opt.brokerHost, opt.brokerPort))
+          return false;
+      }
+      else if (strcmp(arg, "--api") == 0)
+      {
+        if (!parseHostPort(value, opt.apiHost, opt.apiPort))
+          return false;
+      }
+      else if (strcmp(arg, "--query-ms") == 0)
+        opt.queryMs = (uint32_t)atoi(value);
+      else if (strcmp(arg, "--seed") == 0)
+        opt.seed = (uint32_t)atoi(value);
+      else
+        return false;
+      i++;
+    }
+    return opt.devices > 0 && opt.motion >= 0;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  Options opt;
+  if (!parseArgs(argc, argv, opt))
+  {
+    fprintf(stderr,
+            "usage: %s [--devices N] [--duration-s S] [--ramp-s S] [--motion R]\n"
+            "          [--broker HOST:PORT] [--api HOST:PORT] [--query-ms N] [--seed N]\n",
+            argv[0]);
+    return 2;
+  }
+
+  MqttConnection monitor;
+  if (!monitor.connect(opt, "fleet-monitor"))
+  {
+    fprintf(stderr, "cannot connect to the broker at %s:%u\n", opt.brokerHost.c_str(), opt.brokerPort);
+    return 1;
+  }
+  monitor.subscribe("devices/+/sensor/frame");
+  monitor.subscribe("logger/stats");
+
+  std::vector<Device> devices(opt.devices);
+  for (size_t i = 0; i < devices.size(); i++)
+  {
+    Device &d = devices[i];
+    snprintf(d.id, sizeof(d.id), "02fe%08x", (unsigned)i); // locally administered MAC
+    char prefix[24];
+    snprintf(prefix, sizeof(prefix), "devices/%s", d.id);
+    joinTopic(d.topic, sizeof(d.topic), prefix, "sensor/frame");
+    joinTopic(d.batchTopic, sizeof(d.batchTopic), prefix, "sensor/frame/batch");
+    memset(d.sentSeq, 0xff, sizeof(d.sentSeq));
+  }
+
+  std::mt19937 rng(opt.seed);
+  std::vector<double> brokerMs, endToEndMs, flushMs;
+  long loggerRows = -1, loggerRowsAtStart = -1;
+  uint64_t loggerFirstUs = 0, loggerLastUs = 0;
+  std::atomic<long> tableRows{0};
+  uint64_t framesSent = 0, framesDelivered = 0, framesReplayed = 0;
+
+  // /sensors is queried from its own thread so a slow API never delays a board.
+  std::mutex queryLock;
+  std::vector<QuerySample> queries;
+  uint32_t queryFailures = 0;
+  std::atomic<bool> running{true};
+  std::thread queryThread([&] {
+    while (opt.queryMs > 0 && running)
+    {
+      bool ok;
+      double ms = querySensors(opt, ok);
+      {
+        std::lock_guard<std::mutex> lock(queryLock);
+        if (ok)
+          queries.push_back({tableRows.load(), ms});
+        else
+          queryFailures++;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(opt.queryMs));
+    }
+  });
+
+  auto onMonitorPublish = [&](const std::string &topic, const uint8_t *payload, size_t length) {
+    uint64_t now = nowUs();
+    if (topic == "logger/stats")
+    {
+      std::string json((const char *)payload, length);
+      long total = jsonNumber(json.c_str(), "total");
+      long flush = jsonNumber(json.c_str(), "flush_ms");
+      if (total >= 0)
+      {
+        if (loggerRowsAtStart < 0)
+        {
+          loggerRowsAtStart = total;
+          loggerFirstUs = now;
+        }
+        loggerRows = total;
+        loggerLastUs = now;
+        tableRows = total;
+      }
+      if (flush >= 0)
+        flushMs.push_back((double)flush);
+      std::string device;
+      uint16_t seq;
+      if (jsonFrameRef(json.c_str(), "first", device, seq))
+      {
+        uint64_t sent = sentAt(devices, device.c_str(), device.size(), seq);
+        if (sent)
+          endToEndMs.push_back((now - sent) / 1000.0);
+      }
+      return;
+    }
+    // devices/<id>/sensor/frame
+    const char *id = topicUnder(topic.c_str(), "devices");
+    if (!id || length < 4)
+      return;
+    const char *slash = strchr(id, '/');
+    uint64_t sent = slash ? sentAt(devices, id, slash - id, (uint16_t)(payload[2] | payload[3] << 8)) : 0;
+    if (sent)
+    {
+      brokerMs.push_back((now - sent) / 1000.0);
+      framesDelivered++;
+    }
+  };
+
+  const uint64_t startUs = nowUs();
+  const uint64_t rampUs = (uint64_t)opt.rampS * 1000000;
+  const uint64_t endUs = startUs + rampUs + (uint64_t)opt.durationS * 1000000;
+  size_t nextConnect = 0;
+  uint32_t connectFailures = 0, disconnects = 0, reconnects = 0;
+  uint64_t nextProgressUs = startUs + 5000000;
+  uint64_t framesAtProgress = 0;
+  long rowsAtProgress = 0;
+  std::vector<pollfd> fds;
+  std::vector<MqttConnection *> owners;
+
+  printf("t_s  boards  frames/s  broker_p99_ms  logger_rows  rows/s  sensors_ms\n");
+  uint64_t monitorRetryUs = 0;
+  for (uint64_t now = nowUs(); now < endUs; now = nowUs())
+  {
+    // a broker restart is part of the test: the boards journal through it
+    if (!monitor.connected() && now >= monitorRetryUs)
+    {
+      if (monitor.connect(opt, "fleet-monitor"))
+      {
+        monitor.subscribe("devices/+/sensor/frame");
+        monitor.subscribe("logger/stats");
+      }
+      monitorRetryUs = now + 1000000;
+      now = nowUs();
+    }
+
+    // spread the connects evenly over the ramp
+    while (nextConnect < devices.size() &&
+           now - startUs >= (devices.size() > 1 ? rampUs * nextConnect / (devices.size() - 1) : 0))
+    {
+      Device &d = devices[nextConnect++];
+      d.booted = true;
+      d.bootUs = d.nextConnectUs = now;
+      d.nextKnockUs = nextKnock(opt, rng, now);
+    }
+
+    for (Device &d : devices)
+    {
+      if (!d.booted)
+        continue;
+      if (!d.mqtt.connected() && now >= d.nextConnectUs)
+      {
+        char clientId[24];
+        snprintf(clientId, sizeof(clientId), "ESP32Client-%s", d.id + 6);
+        if (d.mqtt.connect(opt, clientId))
+        {
+          if (d.everConnected)
+            reconnects++;
+          d.everConnected = true;
+          d.connectAttempts = 0;
+          d.nextReplayUs = now + std::uniform_int_distribution<uint64_t>(0, REPLAY_START_JITTER_MS * 1000ull)(rng);
+        }
+        else
+        {
+          connectFailures++;
+          // paced like ConnectionManager's broker retries
+          d.nextConnectUs = now + backoffDelayMs(d.connectAttempts, MQTT_BACKOFF_BASE_MS, MQTT_BACKOFF_MAX_MS,
+                                                 std::uniform_int_distribution<uint32_t>()(rng)) * 1000ull;
+          if (d.connectAttempts < UINT8_MAX)
+            d.connectAttempts++;
+        }
+        now = nowUs();
+      }
+      bool live = sampleStep(d, opt, rng, now);
+      if (live)
+        framesSent++;
+      else if (d.mqtt.connected())
+        framesReplayed += replayJournal(d, now);
+      if (d.mqtt.connected())
+        d.mqtt.keepAlive(now);
+    }
+    uint64_t nextEventUs = now + STEP_US;
+
+    fds.clear();
+    owners.clear();
+    if (monitor.connected())
+    {
+      fds.push_back({monitor.fd(), (short)(POLLIN | (monitor.wantsWrite() ? POLLOUT : 0)), 0});
+      owners.push_back(&monitor);
+    }
+    for (Device &d : devices)
+    {
+      if (d.mqtt.connected())
+      {
+        // boards only read PINGRESPs, which are drained with the writes
+        fds.push_back({d.mqtt.fd(), (short)(POLLIN | (d.mqtt.wantsWrite() ? POLLOUT : 0)), 0});
+        owners.push_back(&d.mqtt);
+      }
+    }
+    int timeoutMs = nextEventUs > now ? (int)((nextEventUs - now + 999) / 1000) : 0;
+    if (poll(fds.data(), fds.size(), timeoutMs) > 0)
+    {
+      for (size_t i = 0; i < fds.size(); i++)
+      {
+        MqttConnection &c = *owners[i];
+        if (fds[i].revents & POLLOUT)
+          c.onWritable();
+        if (c.connected() && (fds[i].revents & (POLLIN | POLLHUP | POLLERR)))
+        {
+          if (&c == &monitor)
+            c.onReadable(onMonitorPublish);
+          else
+            c.onReadable([](const std::string &, const uint8_t *, size_t) {});
+        }
+        if (!c.connected() && &c != &monitor)
+          disconnects++;
+      }
+    }
+
+    if (now >= nextProgressUs)
+    {
+      double windowS = 5.0;
+      double sensorsMs = 0;
+      {
+        std::lock_guard<std::mutex> lock(queryLock);
+        if (!queries.empty())
+          sensorsMs = queries.back().ms;
+      }
+      std::vector<double> recent(brokerMs.end() - std::min(brokerMs.size(), (size_t)(framesDelivered - framesAtProgress)),
+                                 brokerMs.end());
+      long rows = std::max(loggerRows, 0L);
+      printf("%-4.0f %-7zu %-9.1f %-14.1f %-12ld %-7.0f %.1f\n", (now - startUs) / 1e6, nextConnect,
+             (framesDelivered - framesAtProgress) / windowS, percentile(recent, 0.99), rows,
+             (rows - rowsAtProgress) / windowS, sensorsMs);
+      fflush(stdout);
+      framesAtProgress = framesDelivered;
+      rowsAtProgress = rows;
+      nextProgressUs += 5000000;
+    }
+  }
+
+  running = false;
+  queryThread.join();
+  // a last look for logger flushes still in flight
+  for (uint64_t drainEnd = nowUs() + 1000000; nowUs() < drainEnd && monitor.connected();)
+  {
+    pollfd pfd = {monitor.fd(), POLLIN, 0};
+    if (poll(&pfd, 1, 100) > 0)
+      monitor.onReadable(onMonitorPublish);
+  }
+
+  printf("\n");
+  printf("boards                %u\n", opt.devices);
+  printf("connect_failures      %u\n", connectFailures);
+  printf("disconnects           %u\n", disconnects);
+  printf("reconnects            %u\n", reconnects);
+  printf("frames_sent           %llu\n", (unsigned long long)framesSent);
+  printf("frames_replayed       %llu\n", (unsigned long long)framesReplayed);
+  printf("frames_delivered      %llu\n", (unsigned long long)framesDelivered);
+  printf("broker_ms p50         %.2f\n", percentile(brokerMs, 0.50));
+  printf("broker_ms p99         %.2f\n", percentile(brokerMs, 0.99));
+  printf("broker_ms p99.9       %.2f\n", percentile(brokerMs, 0.999));
+  printf("broker_ms max         %.2f\n", brokerMs.empty() ? 0.0 : brokerMs.back());
+  if (loggerRows < 0)
+  {
+    printf("logger                no logger/stats seen (is mqtt_logger.js running on this broker?)\n");
+  }
+  else
+  {
+    double loggerS = (loggerLastUs - loggerFirstUs) / 1e6;
+    printf("logger_rows           %ld\n", loggerRows);
+    printf("logger_rows/s         %.1f\n", loggerS > 0 ? (loggerRows - loggerRowsAtStart) / loggerS : 0.0);
+    printf("logger_flush_ms p50   %.1f\n", percentile(flushMs, 0.50));
+    printf("logger_flush_ms max   %.1f\n", flushMs.empty() ? 0.0 : flushMs.back());
+    printf("end_to_end_ms p50     %.1f\n", percentile(endToEndMs, 0.50));
+    printf("end_to_end_ms p99     %.1f\n", percentile(endToEndMs, 0.99));
+    printf("end_to_end_ms max     %.1f\n", endToEndMs.empty() ? 0.0 : endToEndMs.back());
+  }
+
+  if (opt.queryMs > 0)
+  {
+    printf("sensors_queries       %zu ok, %u failed\n", queries.size(), queryFailures);
+    // response time as the table grew, in four equal slices of the run
+    const size_t slices = 4;
+    for (size_t s = 0; s < slices && !queries.empty(); s++)
+    {
+      size_t from = queries.size() * s / slices, to = queries.size() * (s + 1) / slices;
+      if (from == to)
+        continue;
+      std::vector<double> ms;
+      for (size_t i = from; i < to; i++)
+        ms.push_back(queries[i].ms);
+      printf("sensors_ms @%-9ld p50 %.1f  p99 %.1f\n", queries[to - 1].rows, percentile(ms, 0.50),
+             percentile(ms, 0.99));
+    }
+  }
+  return 0;
+}
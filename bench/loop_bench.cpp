@@ -0,0 +1,682 @@
+// Host benchmark for the firmware loop.
+//
+// Links against the real src/main.cpp and the stand-ins in host/, replays a
+// scripted sensor trace and reports, per loop() iteration, the modeled device
+// time (virtual clock: I2C, DHT protocol, TCP writes, UART, delay()) and the
+// host CPU time, plus publishes, bytes on the wire and heap allocations per
+// sample cycle.
+//
+// Firmware that starts FreeRTOS tasks in setup() runs under the host task
+// scheduler instead of loop(); the report then gives, per task, the device
+// time of each iteration and how late it woke up against its schedule.
+//
+// Usage: program [trace.csv] [--duration-ms N] [--tick-ms N] [--cycle-ms N]
+//                [--button-pin N] [--fifo-dump file.hex]
+//                [--dht-edges file.txt] [--dht-pin N] [--mpu-int-pin N]
+//                [--led-every-ms N] [--alert-config JSON] [--echo]
+//
+// Trace format (see bench/traces/): one row per change, applied as a step
+// function from its timestamp onwards; lines starting with '#' are comments.
+//   t_ms,temp,hum,ax,ay,az,gx,gy,gz,button,wifi,broker
+// temp/hum may be "nan" to make the DHT read fail.
+//
+// A FIFO dump (--fifo-dump) is a hex text file of recorded MPU6050 FIFO
+// bytes, whitespace ignored; it is replayed into the simulated FIFO once the
+// firmware enables it, after which samples come from the trace again.
+//
+// A DHT edge file (--dht-edges) holds recorded DHT11 answers, one
+// transaction per line as falling-edge times in us after the start pulse is
+// released. They answer the firmware's first transactions in order; after
+// that the simulated sensor encodes the trace values again.
+//
+// --led-every-ms sends an actuator/led command (alternately "1" and "0") from
+// the broker at that interval, to exercise the receive path.
+//
+// --alert-config retains the JSON on config/alerts before boot, so the
+// firmware gets it on every subscribe; the last status/config ack is
+// printed in the report.
+//
+// When the firmware enters deep sleep the trace keeps playing until a wake-up
+// source fires, then setup() runs again as after a reset; the report adds the
+// time asleep and the wake-up to first publish latency.
+//
+// `pio test -e native` links the same sources with the tests in test/, which
+// bring their own main(); the bench is left out there.
+
+#ifndef PIO_UNIT_TESTING
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "HostSim.h"
+#include "TelemetryPolicy.h"
+
+void setup();
+void loop();
+
+namespace
+{
+  struct TraceRow
+  {
+    uint64_t tMs;
+    hostsim::SensorFrame frame;
+    int button;
+    bool wifi;
+    bool broker;
+  };
+
+  struct Options
+  {
+    const char *tracePath = nullptr;
+    uint64_t durationMs = 0;
+    uint32_t tickMs = 1;
+    uint32_t cycleMs = 5000;
+    uint8_t buttonPin = 4;
+    const char *fifoDumpPath = nullptr;
+    const char *dhtEdgesPath = nullptr;
+    uint8_t dhtPin = 14;
+    uint8_t mpuIntPin = 27;
+    uint32_t ledEveryMs = 0;
+    const char *alertConfig = nullptr;
+    bool echo = false;
+  };
+
+  bool parseRow(const char *line, TraceRow &row)
+  {
+    char temp[16], hum[16];
+    int ax, ay, az, gx, gy, gz, button, wifi, broker;
+    unsigned long long t;
+    if (sscanf(line, "%llu,%15[^,],%15[^,],%d,%d,%d,%d,%d,%d,%d,%d,%d", &t, temp, hum, &ax, &ay, &az, &gx, &gy,
+               &gz, &button, &wifi, &broker) != 12)
+      return false;
+    row.tMs = t;
+    row.frame.dhtFails = strcmp(temp, "nan") == 0 || strcmp(hum, "nan") == 0;
+    row.frame.temperature = row.frame.dhtFails ? 0.0f : (float)atof(temp);
+    row.frame.humidity = row.frame.dhtFails ? 0.0f : (float)atof(hum);
+    row.frame.accel[0] = (int16_t)ax;
+    row.frame.accel[1] = (int16_t)ay;
+    row.frame.accel[2] = (int16_t)az;
+    row.frame.gyro[0] = (int16_t)gx;
+    row.frame.gyro[1] = (int16_t)gy;
+    row.frame.gyro[2] = (int16_t)gz;
+    row.button = button;
+    row.wifi = wifi != 0;
+    row.broker = broker != 0;
+    return true;
+  }
+
+  bool loadTrace(const char *path, std::vector<TraceRow> &rows)
+  {
+    FILE *f = fopen(path, "r");
+    if (!f)
+    {
+      fprintf(stderr, "cannot open trace %s\n", path);
+      return false;
+    }
+    char line[256];
+    int lineNo = 0;
+    while (fgets(line, sizeof(line), f))
+    {
+      lineNo++;
+      if (line[0] == '#' || line[0] == '\n' || line[0] == '\r')
+        continue;
+      TraceRow row;
+      if (!parseRow(line, row))
+      {
+        fprintf(stderr, "%s:%d: malformed trace row\n", path, lineNo);
+        fclose(f);
+        return false;
+      }
+      rows.push_back(row);
+    }
+    fclose(f);
+    return true;
+  }
+
+  int hexDigit(int c)
+  {
+    if (c >= '0' && c <= '9')
+      return c - '0';
+    if (c >= 'a' && c <= 'f')
+      return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+      return c - 'A' + 10;
+    return -1;
+  }
+
+  bool loadFifoDump(const char *path, std::vector<uint8_t> &bytes)
+  {
+    FILE *f = fopen(path, "r");
+    if (!f)
+    {
+      fprintf(stderr, "cannot open FIFO dump %s\n", path);
+      return false;
+    }
+    char line[256];
+    int lineNo = 0;
+    while (fgets(line, sizeof(line), f))
+    {
+      lineNo++;
+      if (line[0] == '#')
+        continue;
+      int high = -1;
+      for (const char *p = line; *p; p++)
+      {
+        if (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+          continue;
+        int digit = hexDigit(*p);
+        if (digit < 0)
+        {
+          fprintf(stderr, "%s:%d: not a hex digit\n", path, lineNo);
+          fclose(f);
+          return false;
+        }
+        if (high < 0)
+        {
+          high = digit;
+        }
+        else
+        {
+          bytes.push_back((uint8_t)(high << 4 | digit));
+          high = -1;
+        }
+      }
+    }
+    fclose(f);
+    return true;
+  }
+
+  // One recorded DHT11 transaction per line: falling-edge times in us after
+  // the start pulse is released, separated by spaces or commas.
+  bool loadDhtEdges(const char *path, std::vector<std::vector<uint32_t>> &transactions)
+  {
+    FILE *f = fopen(path, "r");
+    if (!f)
+    {
+      fprintf(stderr, "cannot open DHT edge file %s\n", path);
+      return false;
+    }
+    char line[1024];
+    int lineNo = 0;
+    while (fgets(line, sizeof(line), f))
+    {
+      lineNo++;
+      if (line[0] == '#' || line[0] == '\n' || line[0] == '\r')
+        continue;
+      std::vector<uint32_t> edges;
+      for (char *p = line; *p;)
+      {
+        if (*p == ' ' || *p == ',' || *p == '\t' || *p == '\r' || *p == '\n')
+        {
+          p++;
+          continue;
+        }
+        char *end;
+        unsigned long us = strtoul(p, &end, 10);
+        if (end == p)
+        {
+          fprintf(stderr, "%s:%d: not an edge time\n", path, lineNo);
+          fclose(f);
+          return false;
+        }
+        edges.push_back((uint32_t)us);
+        p = end;
+      }
+      transactions.push_back(edges);
+    }
+    fclose(f);
+    return true;
+  }
+
+  // Quiet room for 10 minutes with one knock on the desk.
+  void builtinTrace(std::vector<TraceRow> &rows)
+  {
+    TraceRow row = {};
+    row.button = 1;
+    row.wifi = row.broker = true;
+    rows.push_back(row);
+
+    row.tMs = 300000;
+    row.frame.accel[0] = 21000;
+    row.frame.gyro[1] = 900;
+    rows.push_back(row);
+
+    row.tMs = 300050;
+    row.frame.accel[0] = 0;
+    row.frame.gyro[1] = 0;
+    rows.push_back(row);
+
+    row.tMs = 600000;
+    rows.push_back(row);
+  }
+
+  void applyRow(const TraceRow &row, uint8_t buttonPin)
+  {
+    hostsim::sensors() = row.frame;
+    hostsim::setPinLevel(buttonPin, row.button ? 1 : 0);
+    hostsim::setWifiAvailable(row.wifi);
+    hostsim::setBrokerAvailable(row.broker);
+  }
+
+  // Trace playback runs from the clock hook so rows apply inside blocking
+  // calls too.
+  struct Playback
+  {
+    const std::vector<TraceRow> *rows = nullptr;
+    size_t next = 0;
+    uint64_t startUs = 0;
+    uint64_t abortUs = 0;
+    uint8_t buttonPin = 0;
+    uint64_t ledEveryUs = 0;
+    uint64_t nextLedUs = 0;
+    bool ledOn = false;
+  };
+
+  Playback playback;
+
+  // Trace rows that knock the accelerometer, to the first live frame carrying
+  // the motion alert.
+  struct MotionAlertLatency
+  {
+    bool pending = false;
+    uint64_t eventUs = 0;
+    std::vector<uint64_t> us;
+  };
+
+  MotionAlertLatency motionAlertLatency;
+
+  double accelMagnitude(const hostsim::SensorFrame &frame)
+  {
+    return sqrt((double)frame.accel[0] * frame.accel[0] + (double)frame.accel[1] * frame.accel[1] +
+                (double)frame.accel[2] * frame.accel[2]);
+  }
+
+  // A change of over 0.5 g (8192 counts) that takes |a| further from 1 g: a
+  // knock, and not the row that ends one.
+  bool isMotionEvent(const hostsim::SensorFrame &prev, const hostsim::SensorFrame &frame)
+  {
+    double dx = frame.accel[0] - prev.accel[0], dy = frame.accel[1] - prev.accel[1],
+           dz = frame.accel[2] - prev.accel[2];
+    return sqrt(dx * dx + dy * dy + dz * dz) > 8192 &&
+           fabs(accelMagnitude(frame) - 16384) > fabs(accelMagnitude(prev) - 16384);
+  }
+
+  struct SimulationOverrun
+  {
+  };
+
+  void onClock(uint64_t nowUs)
+  {
+    if (nowUs > playback.abortUs)
+      throw SimulationOverrun();
+    const std::vector<TraceRow> &rows = *playback.rows;
+    uint64_t elapsedMs = (nowUs - playback.startUs) / 1000;
+    while (playback.next < rows.size() && rows[playback.next].tMs <= elapsedMs)
+    {
+      const TraceRow &prev = rows[playback.next > 0 ? playback.next - 1 : 0];
+      const TraceRow &row = rows[playback.next++];
+      if (!motionAlertLatency.pending && isMotionEvent(prev.frame, row.frame))
+      {
+        motionAlertLatency.pending = true;
+        motionAlertLatency.eventUs = nowUs;
+      }
+      applyRow(row, playback.buttonPin);
+    }
+    if (playback.ledEveryUs && nowUs >= playback.nextLedUs)
+    {
+      playback.ledOn = !playback.ledOn;
+      hostsim::injectMqtt("actuator/led", (const uint8_t *)(playback.ledOn ? "1" : "0"), 1);
+      playback.nextLedUs = nowUs + playback.ledEveryUs;
+    }
+  }
+
+  struct TaskSeries
+  {
+    std::vector<uint64_t> lateUs;
+    std::vector<uint64_t> busyUs;
+  };
+
+  std::vector<TaskSeries> taskSeries;
+
+  void onTaskIteration(size_t task, uint64_t lateUs, uint64_t busyUs)
+  {
+    if (task >= taskSeries.size())
+      return;
+    taskSeries[task].lateUs.push_back(lateUs);
+    taskSeries[task].busyUs.push_back(busyUs);
+  }
+
+  // Wake-up to the first publish that reaches the broker, per deep sleep.
+  struct WakeLatency
+  {
+    bool awaiting = false;
+    uint64_t wokeUs = 0;
+    std::vector<uint64_t> us;
+  };
+
+  WakeLatency wakeLatency;
+
+  // status/diagnostics messages; the last one is printed in the report. A
+  // fixed buffer, as the hook runs with heap accounting on.
+  struct DiagnosticsSeen
+  {
+    size_t count = 0;
+    size_t maxBytes = 0;
+    char last[512] = {};
+  };
+
+  DiagnosticsSeen diagnostics;
+
+  char configLast[320] = {}; // the last status/config ack
+
+  bool endsWith(const char *text, const char *suffix)
+  {
+    size_t textLength = strlen(text), suffixLength = strlen(suffix);
+    return textLength >= suffixLength && strcmp(text + textLength - suffixLength, suffix) == 0;
+  }
+
+  void onPublish(const char *topic, const uint8_t *payload, size_t length, bool)
+  {
+    TelemetrySample frame;
+    if (motionAlertLatency.pending && endsWith(topic, "sensor/frame") &&
+        decodeTelemetryFrame(payload, length, frame) && (frame.flags & FRAME_MOTION_ALERT))
+    {
+      motionAlertLatency.pending = false;
+      motionAlertLatency.us.push_back(hostsim::nowMicros() - motionAlertLatency.eventUs);
+    }
+    // bare or under the device prefix
+    if (endsWith(topic, "status/diagnostics"))
+    {
+      diagnostics.count++;
+      diagnostics.maxBytes = std::max(diagnostics.maxBytes, length);
+      size_t kept = std::min(length, sizeof(diagnostics.last) - 1);
+      memcpy(diagnostics.last, payload, kept);
+      diagnostics.last[kept] = '\0';
+    }
+    if (endsWith(topic, "status/config"))
+    {
+      size_t kept = std::min(length, sizeof(configLast) - 1);
+      memcpy(configLast, payload, kept);
+      configLast[kept] = '\0';
+    }
+    if (!wakeLatency.awaiting)
+      return;
+    wakeLatency.awaiting = false;
+    wakeLatency.us.push_back(hostsim::nowMicros() - wakeLatency.wokeUs);
+  }
+
+  uint64_t percentile(const std::vector<uint64_t> &sorted, double p)
+  {
+    if (sorted.empty())
+      return 0;
+    size_t index = (size_t)(p * (double)(sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+  }
+
+  bool parseArgs(int argc, char **argv, Options &opt)
+  {
+    for (int i = 1; i < argc; i++)
+    {
+      const char *arg = argv[i];
+      bool hasValue = i + 1 < argc;
+      if (strcmp(arg, "--duration-ms") == 0 && hasValue)
+        opt.durationMs = strtoull(argv[++i], nullptr, 10);
+      else if (strcmp(arg, "--tick-ms") == 0 && hasValue)
+        opt.tickMs = (uint32_t)strtoul(argv[++i], nullptr, 10);
+      else if (strcmp(arg, "--cycle-ms") == 0 && hasValue)
+        opt.cycleMs = (uint32_t)strtoul(argv[++i], nullptr, 10);
+      else if (strcmp(arg, "--button-pin") == 0 && hasValue)
+        opt.buttonPin = (uint8_t)strtoul(argv[++i], nullptr, 10);
+      else if (strcmp(arg, "--fifo-dump") == 0 && hasValue)
+        opt.fifoDumpPath = argv[++i];
+      else if (strcmp(arg, "--dht-edges") == 0 && hasValue)
+        opt.dhtEdgesPath = argv[++i];
+      else if (strcmp(arg, "--dht-pin") == 0 && hasValue)
+        opt.dhtPin = (uint8_t)strtoul(argv[++i], nullptr, 10);
+      else if (strcmp(arg, "--mpu-int-pin") == 0 && hasValue)
+        opt.mpuIntPin = (uint8_t)strtoul(argv[++i], nullptr, 10);
+      else if (strcmp(arg, "--led-every-ms") == 0 && hasValue)
+        opt.ledEveryMs = (uint32_t)strtoul(argv[++i], nullptr, 10);
+      else if (strcmp(arg, "--alert-config") == 0 && hasValue)
+        opt.alertConfig = argv[++i];
+      else if (strcmp(arg, "--echo") == 0)
+        opt.echo = true;
+      else if (arg[0] != '-' && !opt.tracePath)
+        opt.tracePath = arg;
+      else
+        return false;
+    }
+    return opt.tickMs > 0 && opt.cycleMs > 0;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  // the harness's own buffers are not part of the modeled device heap
+  hostsim::setHeapAccounting(false);
+  Options opt;
+  if (!parseArgs(argc, argv, opt))
+  {
+    fprintf(stderr, "usage: %s [trace.csv] [--duration-ms N] [--tick-ms N] [--cycle-ms N] "
+                    "[--button-pin N] [--fifo-dump file.hex] [--dht-edges file.txt] [--dht-pin N] "
+                    "[--mpu-int-pin N] [--led-every-ms N] [--alert-config JSON] [--echo]\n",
+            argv[0]);
+    return 2;
+  }
+
+  std::vector<TraceRow> trace;
+  if (!opt.tracePath)
+    builtinTrace(trace);
+  else if (!loadTrace(opt.tracePath, trace))
+    return 1;
+  if (trace.empty())
+  {
+    fprintf(stderr, "empty trace\n");
+    return 1;
+  }
+  uint64_t endMs = opt.durationMs ? opt.durationMs : trace.back().tMs;
+
+  std::vector<uint8_t> fifoDump;
+  if (opt.fifoDumpPath)
+  {
+    if (!loadFifoDump(opt.fifoDumpPath, fifoDump))
+      return 1;
+    hostsim::replayFifo(fifoDump.data(), fifoDump.size());
+  }
+  hostsim::setDhtPin(opt.dhtPin);
+  hostsim::setMpuIntPin(opt.mpuIntPin);
+  if (opt.dhtEdgesPath)
+  {
+    std::vector<std::vector<uint32_t>> transactions;
+    if (!loadDhtEdges(opt.dhtEdgesPath, transactions))
+      return 1;
+    for (const std::vector<uint32_t> &edges : transactions)
+      hostsim::replayDhtTransaction(edges.data(), edges.size());
+  }
+
+  if (opt.alertConfig &&
+      !hostsim::retainMqtt("config/alerts", (const uint8_t *)opt.alertConfig, strlen(opt.alertConfig)))
+  {
+    fprintf(stderr, "alert config too long\n");
+    return 1;
+  }
+
+  hostsim::setSerialEcho(opt.echo);
+  hostsim::resetClock();
+  applyRow(trace[0], opt.buttonPin);
+  hostsim::setHeapAccounting(true);
+  setup();
+  uint64_t setupUs = hostsim::nowMicros();
+  hostsim::setHeapAccounting(false);
+
+  std::vector<uint64_t> deviceUs;
+  std::vector<uint64_t> hostNs;
+  deviceUs.reserve(endMs / opt.tickMs + 1);
+  hostNs.reserve(endMs / opt.tickMs + 1);
+  size_t tasks = hostsim::taskCount();
+  taskSeries.resize(tasks);
+  for (TaskSeries &series : taskSeries)
+  {
+    // tasks wake at most once per 1 ms tick
+    series.lateUs.reserve(endMs + 1);
+    series.busyUs.reserve(endMs + 1);
+  }
+  wakeLatency.us.reserve(endMs / 1000 + 1);
+  motionAlertLatency.us.reserve(trace.size());
+  hostsim::resetCounters();
+  hostsim::setHeapAccounting(true);
+  size_t startFreeHeap = hostsim::heap().free;
+
+  uint64_t startUs = hostsim::nowMicros();
+  uint64_t endUs = startUs + endMs * 1000;
+  playback.rows = &trace;
+  playback.next = 1;
+  playback.startUs = startUs;
+  // a loop() still blocked a minute past the end of the trace never returns
+  playback.abortUs = endUs + 60000000ULL;
+  playback.buttonPin = opt.buttonPin;
+  playback.ledEveryUs = (uint64_t)opt.ledEveryMs * 1000;
+  playback.nextLedUs = startUs + playback.ledEveryUs;
+  hostsim::setClockHook(onClock);
+
+  hostsim::setPublishHook(onPublish);
+
+  // Each pass is one boot; a deep sleep ends it and the wake-up boots again.
+  bool overrun = false;
+  for (;;)
+  {
+    if (tasks > 0)
+    {
+      hostsim::setTaskHook(onTaskIteration);
+      hostsim::runTasks(endUs);
+      hostsim::setTaskHook(nullptr);
+    }
+    while (tasks == 0 && hostsim::nowMicros() < endUs)
+    {
+      uint64_t before = hostsim::nowMicros();
+      auto hostBefore = std::chrono::steady_clock::now();
+      bool slept = false;
+      try
+      {
+        loop();
+      }
+      catch (const SimulationOverrun &)
+      {
+        overrun = true;
+      }
+      catch (const hostsim::DeepSleep &)
+      {
+        slept = true;
+      }
+      auto hostAfter = std::chrono::steady_clock::now();
+      uint64_t after = hostsim::nowMicros();
+
+      deviceUs.push_back(after - before);
+      hostNs.push_back((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(hostAfter - hostBefore).count());
+
+      // idle until the next tick if the iteration finished early
+      uint64_t tickEnd = before + (uint64_t)opt.tickMs * 1000;
+      if (overrun || slept)
+        break;
+      if (hostsim::nowMicros() < tickEnd)
+        hostsim::advanceMicros(tickEnd - hostsim::nowMicros());
+    }
+    if (overrun || !hostsim::deepSleepPending() || !hostsim::sleepUntilWake(endUs))
+      break;
+    hostsim::reboot();
+    wakeLatency.awaiting = true;
+    wakeLatency.wokeUs = hostsim::nowMicros();
+    setup();
+  }
+  hostsim::setPublishHook(nullptr);
+  hostsim::setClockHook(nullptr);
+
+  const hostsim::Counters c = hostsim::counters();
+  const hostsim::HeapStats heap = hostsim::heap();
+  hostsim::setHeapAccounting(false);
+  double simulatedMs = (double)(hostsim::nowMicros() - startUs) / 1000.0;
+  double cycles = simulatedMs / opt.cycleMs;
+
+  std::sort(deviceUs.begin(), deviceUs.end());
+  std::sort(hostNs.begin(), hostNs.end());
+  uint64_t hostTotal = 0;
+  for (uint64_t ns : hostNs)
+    hostTotal += ns;
+
+  printf("trace                 %s\n", opt.tracePath ? opt.tracePath : "(builtin)");
+  if (overrun)
+    printf("WARNING               loop() still blocked at end of trace\n");
+  printf("simulated_ms          %.0f\n", simulatedMs);
+  printf("setup_ms              %.1f\n", setupUs / 1000.0);
+  printf("cycles                %.1f\n", cycles);
+  if (tasks == 0)
+  {
+    printf("iterations            %zu\n", deviceUs.size());
+    printf("loop_device_us p50    %llu\n", (unsigned long long)percentile(deviceUs, 0.50));
+    printf("loop_device_us p99    %llu\n", (unsigned long long)percentile(deviceUs, 0.99));
+    printf("loop_device_us p99.9  %llu\n", (unsigned long long)percentile(deviceUs, 0.999));
+    printf("loop_device_us max    %llu\n", (unsigned long long)(deviceUs.empty() ? 0 : deviceUs.back()));
+    printf("loop_host_ns mean     %.0f\n", hostNs.empty() ? 0.0 : (double)hostTotal / hostNs.size());
+    printf("loop_host_ns p99      %llu\n", (unsigned long long)percentile(hostNs, 0.99));
+  }
+  for (size_t i = 0; i < tasks; i++)
+  {
+    TaskSeries &series = taskSeries[i];
+    std::sort(series.busyUs.begin(), series.busyUs.end());
+    std::sort(series.lateUs.begin(), series.lateUs.end());
+    printf("task %-16s core %d\n", hostsim::taskName(i), hostsim::taskCore(i));
+    printf("  iterations          %zu\n", series.busyUs.size());
+    printf("  busy_us p50         %llu\n", (unsigned long long)percentile(series.busyUs, 0.50));
+    printf("  busy_us p99         %llu\n", (unsigned long long)percentile(series.busyUs, 0.99));
+    printf("  busy_us max         %llu\n", (unsigned long long)(series.busyUs.empty() ? 0 : series.busyUs.back()));
+    printf("  late_us p99         %llu\n", (unsigned long long)percentile(series.lateUs, 0.99));
+    printf("  late_us p99.9       %llu\n", (unsigned long long)percentile(series.lateUs, 0.999));
+    printf("  late_us max         %llu\n", (unsigned long long)(series.lateUs.empty() ? 0 : series.lateUs.back()));
+  }
+  printf("publishes/cycle       %.2f\n", c.publishes / cycles);
+  printf("mqtt_bytes/cycle      %.1f\n", c.mqttBytes / cycles);
+  printf("publish_failures      %llu\n", (unsigned long long)c.publishFailures);
+  printf("mqtt_connects         %llu\n", (unsigned long long)c.mqttConnects);
+  printf("heap_allocs/cycle     %.2f\n", c.heapAllocs / cycles);
+  printf("heap_bytes/cycle      %.1f\n", c.heapBytes / cycles);
+  printf("heap_growth_bytes     %lld\n", (long long)startFreeHeap - (long long)heap.free);
+  printf("heap_min_free         %zu\n", heap.minFree);
+  printf("dht_transactions      %llu\n", (unsigned long long)c.dhtTransactions);
+  printf("i2c_bytes/cycle       %.1f\n", c.i2cBytes / cycles);
+  printf("serial_bytes/cycle    %.1f\n", c.serialBytes / cycles);
+  printf("flash_writes          %llu\n", (unsigned long long)c.flashWrites);
+  printf("flash_bytes_written   %llu\n", (unsigned long long)c.flashBytesWritten);
+  printf("flash_erases          %llu\n", (unsigned long long)c.flashErases);
+  if (!motionAlertLatency.us.empty())
+  {
+    std::sort(motionAlertLatency.us.begin(), motionAlertLatency.us.end());
+    printf("motion_alerts         %zu\n", motionAlertLatency.us.size());
+    printf("motion_alert_ms p50   %.1f\n", percentile(motionAlertLatency.us, 0.50) / 1000.0);
+    printf("motion_alert_ms max   %.1f\n", motionAlertLatency.us.back() / 1000.0);
+  }
+  if (diagnostics.count > 0)
+  {
+    printf("diagnostics_msgs      %zu\n", diagnostics.count);
+    printf("diagnostics_bytes max %zu\n", diagnostics.maxBytes);
+    printf("diagnostics_last      %s\n", diagnostics.last);
+  }
+  if (configLast[0])
+    printf("config_last           %s\n", configLast);
+  if (c.deepSleeps > 0)
+  {
+    std::sort(wakeLatency.us.begin(), wakeLatency.us.end());
+    printf("deep_sleeps           %llu\n", (unsigned long long)c.deepSleeps);
+    printf("asleep_ms             %.0f\n", c.sleepUs / 1000.0);
+    printf("wakes_published       %zu\n", wakeLatency.us.size());
+    printf("wake_to_publish_ms p50 %.1f\n", percentile(wakeLatency.us, 0.50) / 1000.0);
+    printf("wake_to_publish_ms max %.1f\n", wakeLatency.us.empty() ? 0.0 : wakeLatency.us.back() / 1000.0);
+  }
+  return 0;
+}
+
+#endif // PIO_UNIT_TESTING
@@ -0,0 +1,29 @@
+#pragma once
+
+// Host stand-in for the Adafruit DHT driver. Like the real driver, a protocol
+// transaction is only run when the last one is more than 2 s old, and every
+// transaction blocks for the modeled start pulse + frame time.
+
+#include <stdint.h>
+
+#define DHT11 11
+#define DHT22 22
+
+class DHT
+{
+public:
+  DHT(uint8_t pin, uint8_t type, uint8_t count = 6);
+  void begin(uint8_t usec = 55);
+  float readTemperature(bool S = false, bool force = false);
+  float readHumidity(bool force = false);
+  bool read(bool force = false);
+
+private:
+  uint8_t pin_;
+  uint8_t type_;
+  bool lastResult_ = false;
+  bool hasRead_ = false;
+  uint32_t lastReadTime_ = 0;
+  float temperature_ = 0.0f;
+  float humidity_ = 0.0f;
+};
@@ -0,0 +1,20 @@
+#pragma once
+
+// Host stand-in for the ESP object of arduino-esp32: heap queries backed by
+// the heap model in HostSim.h, and a cycle counter that follows the virtual
+// clock at the CPU frequency.
+
+#include <stdint.h>
+
+class EspClass
+{
+public:
+  uint32_t getHeapSize();
+  uint32_t getFreeHeap();
+  uint32_t getMinFreeHeap();
+  uint32_t getMaxAllocHeap();
+  uint32_t getCycleCount();
+  uint32_t getCpuFreqMHz() { return 240; }
+};
+
+extern EspClass ESP;
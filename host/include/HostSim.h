@@ -0,0 +1,202 @@
+#pragma once
+
+// Control surface for the host (native) build.
+//
+// The stand-ins for Arduino, Wire, DHT, WiFi and PubSubClient all read their
+// state from here, and the benchmark harness drives it: it moves the virtual
+// clock, feeds sensor values, takes the broker up/down and reads back the
+// counters. Device time is virtual: every stand-in charges a modeled cost
+// (I2C transfer, DHT protocol, TCP write, UART) to the clock, so a blocking
+// call on the board shows up as a blocking call here too.
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace hostsim
+{
+  // ---- Virtual clock -------------------------------------------------------
+
+  // Inside a FreeRTOS task this is the clock of the task's core.
+  uint64_t nowMicros();
+  void advanceMicros(uint64_t us);
+  void resetClock();
+
+  // Called after every clock advance, including those inside blocking calls,
+  // so scripted events (broker back up, button press) land while the firmware
+  // is stuck in a delay() loop. The hook may throw to abandon a run.
+  typedef void (*ClockHook)(uint64_t nowUs);
+  void setClockHook(ClockHook hook);
+
+  // ---- Modeled costs of blocking operations (microseconds) -----------------
+
+  struct CostModel
+  {
+    uint32_t dhtTransactionUs = 23000; // 18 ms start pulse + 40-bit frame
+    uint32_t mqttPublishBaseUs = 350;  // lwIP + TCP write for one packet
+    uint32_t mqttBytesPerMs = 125;     // ~1 Mbit/s effective Wi-Fi uplink
+    uint32_t mqttLoopUs = 40;          // PubSubClient::loop() with nothing pending
+    uint32_t mqttConnectUs = 60000;    // TCP + CONNECT/CONNACK round trip
+    uint32_t wifiAssociateMs = 2500;   // scan + auth + DHCP
+    uint32_t wifiFastAssociateMs = 300; // known channel/BSSID, no scan
+    uint32_t wifiDhcpMs = 150;         // part of either that a static IP skips
+    uint32_t serialBaud = 115200;      // UART TX, 10 bits per byte
+    uint32_t flashWriteUs = 600;       // NVS write: entry lookup + page program
+    uint32_t flashWriteNsPerByte = 2000;
+    uint32_t flashReadUs = 60;
+    uint32_t flashProgramUs = 60;      // raw partition write: command + first byte
+    uint32_t flashEraseUs = 45000;     // one 4 KB sector
+    uint32_t gpioUs = 1;
+    uint32_t isrUs = 2; // GPIO interrupt entry, handler and exit
+  };
+
+  CostModel &costs();
+
+  // ---- FreeRTOS tasks ------------------------------------------------------
+
+  // Runs the tasks created with xTaskCreatePinnedToCore() until every core's
+  // clock has reached untilUs. Returns false if the firmware created none.
+  bool runTasks(uint64_t untilUs);
+  size_t taskCount();
+  const char *taskName(size_t task);
+  int taskCore(size_t task);
+
+  // Called at the end of every task iteration (wake-up to the next
+  // vTaskDelay/vTaskDelayUntil): lateUs is how long after its scheduled wake
+  // time the task resumed, busyUs the device time it then ran for.
+  typedef void (*TaskHook)(size_t task, uint64_t lateUs, uint64_t busyUs);
+  void setTaskHook(TaskHook hook);
+
+  // ---- Sensors -------------------------------------------------------------
+
+  struct SensorFrame
+  {
+    float temperature = 22.0f;
+    float humidity = 45.0f;
+    bool dhtFails = false;
+    int16_t accel[3] = {0, 0, 16384}; // board flat, 1 g on Z
+    int16_t gyro[3] = {0, 0, 0};
+    bool mpuFails = false;
+  };
+
+  SensorFrame &sensors();
+
+  // Replays recorded MPU6050 FIFO contents (12-byte big-endian accel+gyro
+  // records) into the simulated FIFO before falling back to sensors().
+  void replayFifo(const uint8_t *records, size_t length);
+
+  // The simulated DHT11 answers a start pulse on its pin (held low for at
+  // least 18 ms, then released) with a frame encoding sensors(), or with the
+  // next replayed transaction: falling-edge times in us after the release
+  // (response, 40 bit starts, end of frame). A recording with missing edges
+  // or a bad checksum reaches the firmware as it is.
+  void setDhtPin(uint8_t pin);
+  void replayDhtTransaction(const uint32_t *fallingEdgesUs, size_t count);
+
+  // The simulated MPU6050 evaluates its motion detection (MOT_THR/MOT_DUR on
+  // the high-pass filtered accelerometer) as its samples fall due and, with
+  // the motion interrupt enabled, pulses its INT output on this pin.
+  void setMpuIntPin(uint8_t pin);
+
+  // Digital input level seen by digitalRead(). A change is also an edge for
+  // handlers registered with attachInterrupt().
+  void setPinLevel(uint8_t pin, int level);
+  int pinOutput(uint8_t pin);
+
+  // ---- Network -------------------------------------------------------------
+
+  // The simulated access point; its channel can change to invalidate a
+  // cached fast-reconnect target.
+  void setWifiAvailable(bool up);
+  bool wifiAvailable();
+  void setWifiChannel(int32_t channel);
+  int32_t wifiChannel();
+  const uint8_t *wifiBssid();
+  void setBrokerAvailable(bool up);
+  bool brokerAvailable();
+
+  // Queues a message from the broker; delivered by the next client.loop()
+  // if the client subscribed to the topic.
+  bool injectMqtt(const char *topic, const uint8_t *payload, size_t length);
+
+  // Stores a retained message on the broker, replacing the topic's previous
+  // one (an empty payload deletes it). Queued like injectMqtt() whenever the
+  // client subscribes to a matching topic; a reboot keeps it.
+  bool retainMqtt(const char *topic, const uint8_t *payload, size_t length);
+
+  // Called for every publish that reaches the (simulated) broker.
+  typedef void (*PublishHook)(const char *topic, const uint8_t *payload, size_t length, bool retained);
+  void setPublishHook(PublishHook hook);
+
+  // ---- Deep sleep ----------------------------------------------------------
+
+  // esp_deep_sleep_start() halts the firmware: called from a task it ends
+  // runTasks(), called from loop() it throws DeepSleep. The harness then
+  // waits with sleepUntilWake() and boots the firmware with reboot() and
+  // setup().
+  //
+  // A reboot resets what the stand-ins hold (tasks, Wi-Fi, pin outputs) and
+  // restarts millis(), but firmware globals keep their values whether or not
+  // they are RTC_DATA_ATTR: the host cannot catch state that should have been
+  // kept in RTC memory.
+  struct DeepSleep
+  {
+  };
+
+  bool deepSleepPending();
+  // Advances the clock until a wake-up source fires (ext0 level, timer) or
+  // untilUs is reached; returns false if still asleep at untilUs.
+  bool sleepUntilWake(uint64_t untilUs);
+  void reboot();
+
+  // ---- Heap ----------------------------------------------------------------
+
+  // Modeled ESP32 heap behind ESP.getFreeHeap() and friends: a fixed size
+  // minus what the firmware and stand-ins hold. Allocations made while
+  // accounting is off (the harness's own buffers) count neither here nor in
+  // the heap counters.
+  struct HeapStats
+  {
+    size_t size;
+    size_t free;
+    size_t minFree;
+    size_t largestBlock;
+  };
+
+  HeapStats heap();
+  void setHeapAccounting(bool on);
+
+  // ---- Counters ------------------------------------------------------------
+
+  struct Counters
+  {
+    uint64_t publishes = 0;
+    uint64_t publishFailures = 0;
+    uint64_t mqttBytes = 0; // MQTT packets incl. fixed header
+    uint64_t mqttConnects = 0;
+    uint64_t i2cBytes = 0;
+    uint64_t dhtTransactions = 0;
+    uint64_t serialBytes = 0;
+    uint64_t flashWrites = 0;
+    uint64_t flashBytesWritten = 0;
+    uint64_t flashErases = 0;       // 4 KB sectors
+    uint64_t deepSleeps = 0;
+    uint64_t sleepUs = 0;
+    uint64_t heapAllocs = 0;
+    uint64_t heapBytes = 0;
+  };
+
+  Counters &counters();
+  void resetCounters();
+
+  // Serial output is discarded unless echo is enabled (costs are charged
+  // either way).
+  void setSerialEcho(bool echo);
+  bool serialEcho();
+
+  // Internal hooks shared between the stand-ins.
+  namespace detail
+  {
+    void chargeSerial(size_t bytes);
+    void chargeI2c(size_t bytes, uint32_t clockHz);
+  }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "Print.h"
+
+class IPAddress : public Printable
+{
+public:
+  IPAddress() : bytes_{0, 0, 0, 0} {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : bytes_{a, b, c, d} {}
+  // lwIP byte order: first octet in the low byte
+  IPAddress(uint32_t address)
+      : bytes_{(uint8_t)address, (uint8_t)(address >> 8), (uint8_t)(address >> 16), (uint8_t)(address >> 24)}
+  {
+  }
+
+  operator uint32_t() const
+  {
+    return (uint32_t)bytes_[0] | (uint32_t)bytes_[1] << 8 | (uint32_t)bytes_[2] << 16 | (uint32_t)bytes_[3] << 24;
+  }
+
+  uint8_t operator[](int index) const { return bytes_[index]; }
+  bool operator==(const IPAddress &rhs) const
+  {
+    return bytes_[0] == rhs.bytes_[0] && bytes_[1] == rhs.bytes_[1] &&
+           bytes_[2] == rhs.bytes_[2] && bytes_[3] == rhs.bytes_[3];
+  }
+
+  size_t printTo(Print &p) const override
+  {
+    return p.printf("%u.%u.%u.%u", bytes_[0], bytes_[1], bytes_[2], bytes_[3]);
+  }
+
+private:
+  uint8_t bytes_[4];
+};
@@ -0,0 +1,28 @@
+#pragma once
+
+// Host stand-in for the arduino-esp32 Preferences (NVS) API, byte blobs only.
+// Entries live in an in-memory table that survives a simulated reboot, as
+// NVS survives deep sleep and reset. Flash program/read time is charged to
+// the virtual clock, and a write stalls the cores like a partition write.
+
+#include <stddef.h>
+#include <stdint.h>
+
+class Preferences
+{
+public:
+  bool begin(const char *name, bool readOnly = false, const char *partitionLabel = nullptr);
+  void end();
+
+  bool isKey(const char *key);
+  bool remove(const char *key);
+  size_t putBytes(const char *key, const void *value, size_t length);
+  size_t getBytesLength(const char *key);
+  // Returns 0 and copies nothing if the entry is larger than maxLength.
+  size_t getBytes(const char *key, void *buffer, size_t maxLength);
+
+private:
+  char namespace_[16] = {};
+  bool open_ = false;
+  bool readOnly_ = true;
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+// Host stand-in for knolleary/PubSubClient 2.8. Publishes are framed like
+// the real client (QoS 0, MQTT 3.1.1) so the byte counters match what goes
+// on the wire, and inbound messages come from hostsim::injectMqtt().
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Arduino.h"
+
+#ifndef MQTT_MAX_PACKET_SIZE
+#define MQTT_MAX_PACKET_SIZE 256
+#endif
+
+#define MQTT_CONNECTION_TIMEOUT -4
+#define MQTT_CONNECTION_LOST -3
+#define MQTT_CONNECT_FAILED -2
+#define MQTT_DISCONNECTED -1
+#define MQTT_CONNECTED 0
+
+#define MQTT_CALLBACK_SIGNATURE void (*callback)(char *, uint8_t *, unsigned int)
+
+class WiFiClient;
+
+class PubSubClient
+{
+public:
+  explicit PubSubClient(WiFiClient &client);
+
+  PubSubClient &setServer(const char *domain, uint16_t port);
+  PubSubClient &setCallback(MQTT_CALLBACK_SIGNATURE);
+  bool setBufferSize(uint16_t size);
+  uint16_t getBufferSize() const { return bufferSize_; }
+  PubSubClient &setSocketTimeout(uint16_t timeout)
+  {
+    socketTimeout_ = timeout;
+    return *this;
+  }
+
+  bool connect(const char *id);
+  bool connect(const char *id, const char *willTopic, uint8_t willQos, bool willRetain, const char *willMessage);
+  void disconnect();
+  bool connected();
+  int state() const { return state_; }
+
+  bool publish(const char *topic, const char *payload);
+  bool publish(const char *topic, const char *payload, bool retained);
+  bool publish(const char *topic, const uint8_t *payload, unsigned int plength);
+  bool publish(const char *topic, const uint8_t *payload, unsigned int plength, bool retained);
+
+  bool subscribe(const char *topic, uint8_t qos = 0);
+  bool loop();
+
+private:
+  static constexpr int MAX_SUBSCRIPTIONS = 8;
+  static constexpr int MAX_TOPIC = 64;
+
+  bool subscribed(const char *topic) const;
+
+  WiFiClient &client_;
+  void (*callback_)(char *, uint8_t *, unsigned int) = nullptr;
+  uint16_t bufferSize_ = MQTT_MAX_PACKET_SIZE;
+  uint16_t socketTimeout_ = 15;
+  int state_ = MQTT_DISCONNECTED;
+  char subscriptions_[MAX_SUBSCRIPTIONS][MAX_TOPIC];
+  int subscriptionCount_ = 0;
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+// Arduino String stand-in. Like arduino-esp32 it keeps short strings in an
+// inline buffer and reallocates to the exact size on growth, so the host
+// heap counters see the same allocation pattern as the board.
+
+#include <stddef.h>
+#include <stdint.h>
+
+class String
+{
+public:
+  String(const char *cstr = "");
+  String(const String &other);
+  String(String &&other) noexcept;
+  explicit String(char c);
+  explicit String(int value, unsigned char base = 10);
+  explicit String(unsigned int value, unsigned char base = 10);
+  explicit String(long value, unsigned char base = 10);
+  explicit String(unsigned long value, unsigned char base = 10);
+  explicit String(float value, unsigned int decimalPlaces = 2);
+  explicit String(double value, unsigned int decimalPlaces = 2);
+  ~String();
+
+  String &operator=(const String &rhs);
+  String &operator=(String &&rhs) noexcept;
+  String &operator=(const char *cstr);
+
+  String &operator+=(const String &rhs) { return concat(rhs.c_str(), rhs.length()); }
+  String &operator+=(const char *cstr);
+  String &operator+=(char c) { return concat(&c, 1); }
+
+  bool operator==(const String &rhs) const;
+  bool operator==(const char *cstr) const;
+  bool operator!=(const String &rhs) const { return !(*this == rhs); }
+  bool operator!=(const char *cstr) const { return !(*this == cstr); }
+
+  const char *c_str() const { return isSSO() ? sso_ : ptr_; }
+  unsigned int length() const { return len_; }
+  bool reserve(unsigned int size);
+
+private:
+  static constexpr unsigned int SSO_SIZE = 11;
+
+  bool isSSO() const { return ptr_ == nullptr; }
+  char *buffer() { return isSSO() ? sso_ : ptr_; }
+  String &concat(const char *data, unsigned int count);
+  void assign(const char *data, unsigned int count);
+  void release();
+
+  char *ptr_ = nullptr;
+  unsigned int cap_ = SSO_SIZE;
+  unsigned int len_ = 0;
+  char sso_[SSO_SIZE + 1] = {0};
+};
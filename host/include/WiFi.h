@@ -0,0 +1,84 @@
+#pragma once
+
+// Host stand-in for the ESP32 WiFi class. Association completes after the
+// modeled association time once the simulated access point is available.
+
+#include <stdint.h>
+
+#include "Arduino.h"
+#include "IPAddress.h"
+
+typedef enum
+{
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum
+{
+  WIFI_OFF = 0,
+  WIFI_STA = 1
+} wifi_mode_t;
+
+class WiFiClass
+{
+public:
+  bool mode(wifi_mode_t) { return true; }
+  bool setAutoReconnect(bool autoReconnect)
+  {
+    autoReconnect_ = autoReconnect;
+    return true;
+  }
+
+  // With channel and bssid the scan is skipped (fast reconnect); that only
+  // works while the access point is still on the cached channel.
+  wl_status_t begin(const char *ssid, const char *passphrase = nullptr, int32_t channel = 0,
+                    const uint8_t *bssid = nullptr, bool connect = true);
+  bool disconnect(bool wifioff = false);
+  wl_status_t status();
+
+  // A non-zero local address skips DHCP on the next association; all zeros
+  // switches back to DHCP.
+  bool config(IPAddress local, IPAddress gateway, IPAddress subnet, IPAddress dns1 = IPAddress(),
+              IPAddress dns2 = IPAddress());
+  IPAddress localIP();
+  IPAddress gatewayIP();
+  IPAddress subnetMask();
+  IPAddress dnsIP(uint8_t index = 0);
+
+  uint8_t *macAddress(uint8_t *mac);
+  uint8_t *BSSID();
+  int32_t channel();
+
+private:
+  bool started_ = false;
+  bool autoReconnect_ = true;
+  bool lost_ = false;
+  uint64_t associatedAtUs_ = 0;
+  uint8_t bssid_[6] = {0};
+  IPAddress staticIp_;
+};
+
+extern WiFiClass WiFi;
+
+class WiFiClient
+{
+public:
+  bool connected() const;
+
+  // As in arduino-esp32 2.x: seconds, and it bounds connect() as well as
+  // reads. The default is the core's 3 s connect timeout.
+  int setTimeout(uint32_t seconds)
+  {
+    timeoutMs_ = seconds * 1000;
+    return 0;
+  }
+  uint32_t timeoutMs() const { return timeoutMs_; }
+
+private:
+  uint32_t timeoutMs_ = 3000;
+};
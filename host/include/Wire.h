@@ -0,0 +1,48 @@
+#pragma once
+
+// Host stand-in for the ESP32 TwoWire driver. Transfers go to simulated
+// devices on the bus (see HostSim.h) and are charged to the virtual clock at
+// the configured bus speed.
+
+#include <stddef.h>
+#include <stdint.h>
+
+class TwoWire
+{
+public:
+  bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0);
+  bool setClock(uint32_t frequency);
+  uint32_t getClock() const { return clock_; }
+
+  void beginTransmission(uint16_t address);
+  void beginTransmission(int address) { beginTransmission((uint16_t)address); }
+  size_t write(uint8_t data);
+  size_t write(const uint8_t *data, size_t quantity);
+  uint8_t endTransmission(bool sendStop = true);
+
+  size_t requestFrom(uint16_t address, size_t size, bool sendStop = true);
+  size_t requestFrom(uint8_t address, size_t size, bool sendStop)
+  {
+    return requestFrom((uint16_t)address, size, sendStop);
+  }
+  uint8_t requestFrom(int address, int size, int sendStop = 1)
+  {
+    return (uint8_t)requestFrom((uint16_t)address, (size_t)size, sendStop != 0);
+  }
+
+  int available();
+  int read();
+
+private:
+  static constexpr size_t BUFFER_LENGTH = 128;
+
+  uint32_t clock_ = 100000;
+  uint16_t txAddress_ = 0;
+  uint8_t txBuffer_[BUFFER_LENGTH];
+  size_t txLength_ = 0;
+  uint8_t rxBuffer_[BUFFER_LENGTH];
+  size_t rxIndex_ = 0;
+  size_t rxLength_ = 0;
+};
+
+extern TwoWire Wire;
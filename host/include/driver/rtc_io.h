@@ -0,0 +1,9 @@
+#pragma once
+
+// Host stand-in for the RTC GPIO pull configuration kept during deep sleep.
+// Simulated inputs have no electrical pulls, so these only validate the pin.
+
+#include "esp_sleep.h"
+
+esp_err_t rtc_gpio_pullup_en(gpio_num_t gpio);
+esp_err_t rtc_gpio_pulldown_dis(gpio_num_t gpio);
@@ -0,0 +1,8 @@
+#pragma once
+
+// Host stand-in for esp_attr.h. There is no RTC memory on the host: variables
+// marked RTC_DATA_ATTR are ordinary globals, which keep their values across a
+// simulated deep sleep like every other global does (see HostSim.h).
+
+#define RTC_DATA_ATTR
+#define IRAM_ATTR
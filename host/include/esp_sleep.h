@@ -0,0 +1,30 @@
+#pragma once
+
+// Host stand-in for the ESP-IDF sleep API: ext0 and timer wake-up sources and
+// deep sleep. esp_deep_sleep_start() hands control back to the harness, which
+// waits for a wake-up source and boots the firmware again (HostSim.h).
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+typedef enum
+{
+  GPIO_NUM_NC = -1,
+  GPIO_NUM_0 = 0,
+  GPIO_NUM_MAX = 40
+} gpio_num_t;
+
+typedef enum
+{
+  ESP_SLEEP_WAKEUP_UNDEFINED = 0, // power-on or reset, not a wake from sleep
+  ESP_SLEEP_WAKEUP_ALL,
+  ESP_SLEEP_WAKEUP_EXT0,
+  ESP_SLEEP_WAKEUP_EXT1,
+  ESP_SLEEP_WAKEUP_TIMER
+} esp_sleep_wakeup_cause_t;
+
+esp_err_t esp_sleep_enable_ext0_wakeup(gpio_num_t gpio, int level);
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t timeUs);
+[[noreturn]] void esp_deep_sleep_start();
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause();
@@ -0,0 +1,28 @@
+#pragma once
+
+// Host stand-in for the FreeRTOS task API of the ESP32 port. Each task runs
+// on its own std::thread, but only one of them executes at a time: the
+// scheduler in host/src/FreeRTOS.cpp gives every core its own virtual clock
+// and always resumes the task that is furthest behind, so a task blocked in
+// a slow call on one core does not hold up the task pinned to the other.
+// Tasks start running when the harness calls hostsim::runTasks().
+
+#include "FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void *);
+
+struct HostTask;
+typedef HostTask *TaskHandle_t;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char *name, uint32_t stackDepth, void *parameters,
+                                   UBaseType_t priority, TaskHandle_t *createdTask, BaseType_t coreId);
+
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t *previousWakeTime, TickType_t increment);
+TickType_t xTaskGetTickCount();
+
+// Deleting the calling task from outside any task (the Arduino loop() on the
+// host) is a no-op.
+void vTaskDelete(TaskHandle_t task);
+
+BaseType_t xPortGetCoreID();
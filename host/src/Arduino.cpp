@@ -0,0 +1,130 @@
+#include "Arduino.h"
+
+#include <stdio.h>
+
+#include "HostSim.h"
+#include "SimDevices.h"
+
+HardwareSerial Serial;
+
+namespace
+{
+  uint32_t randomState = 1;
+
+  constexpr uint8_t INTERRUPT_PINS = 40;
+
+  struct Interrupt
+  {
+    void (*handler)(void);
+    int mode;
+  };
+
+  Interrupt interrupts[INTERRUPT_PINS];
+  bool inHandler = false;
+  uint64_t handlerAtUs = 0;
+
+  void deliverInterrupts()
+  {
+    if (inHandler)
+      return;
+    hostsim::detail::PinEdge edge;
+    uint32_t handled = 0;
+    while (hostsim::detail::takePinEdge(hostsim::nowMicros(), edge))
+    {
+      const Interrupt &irq = interrupts[edge.pin];
+      bool fires = irq.handler && (irq.mode == CHANGE || (irq.mode == FALLING) == (edge.level == LOW));
+      if (!fires)
+        continue;
+      inHandler = true;
+      handlerAtUs = edge.atUs;
+      irq.handler();
+      inHandler = false;
+      handled++;
+    }
+    if (handled)
+      hostsim::advanceMicros((uint64_t)handled * hostsim::costs().isrUs);
+  }
+
+  uint64_t deviceMicros()
+  {
+    deliverInterrupts();
+    return (inHandler ? handlerAtUs : hostsim::nowMicros()) - hostsim::detail::bootMicros();
+  }
+}
+
+// both restart from zero when the firmware boots again after deep sleep
+unsigned long millis() { return (unsigned long)(deviceMicros() / 1000); }
+unsigned long micros() { return (unsigned long)deviceMicros(); }
+void delay(unsigned long ms) { hostsim::advanceMicros((uint64_t)ms * 1000); }
+void delayMicroseconds(unsigned int us) { hostsim::advanceMicros(us); }
+
+void pinMode(uint8_t pin, uint8_t mode) { hostsim::detail::setPinMode(pin, mode); }
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+  hostsim::advanceMicros(hostsim::costs().gpioUs);
+  hostsim::detail::setPinOutput(pin, val ? HIGH : LOW);
+}
+
+int digitalRead(uint8_t pin)
+{
+  hostsim::advanceMicros(hostsim::costs().gpioUs);
+  deliverInterrupts();
+  return hostsim::detail::pinLevel(pin);
+}
+
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode)
+{
+  if (pin < INTERRUPT_PINS)
+    interrupts[pin] = {handler, mode};
+}
+
+void detachInterrupt(uint8_t pin)
+{
+  if (pin < INTERRUPT_PINS)
+    interrupts[pin] = {nullptr, 0};
+}
+
+namespace hostsim
+{
+  namespace detail
+  {
+    void resetInterrupts()
+    {
+      for (Interrupt &irq : interrupts)
+        irq = {nullptr, 0};
+    }
+  }
+}
+
+void randomSeed(unsigned long seed) { randomState = seed ? (uint32_t)seed : 1; }
+
+long random(long howbig)
+{
+  if (howbig <= 0)
+    return 0;
+  // xorshift32: deterministic across runs so benchmark traces are repeatable
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return (long)(randomState % (uint32_t)howbig);
+}
+
+long random(long howsmall, long howbig)
+{
+  if (howsmall >= howbig)
+    return howsmall;
+  return random(howbig - howsmall) + howsmall;
+}
+
+void HardwareSerial::begin(unsigned long baud) { hostsim::costs().serialBaud = (uint32_t)baud; }
+
+size_t HardwareSerial::write(uint8_t c) { return write(&c, 1); }
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+  hostsim::detail::chargeSerial(size);
+  if (hostsim::serialEcho())
+    fwrite(buffer, 1, size, stdout);
+  return size;
+}
@@ -0,0 +1,48 @@
+#include "DHT.h"
+
+#include <math.h>
+
+#include "Arduino.h"
+#include "HostSim.h"
+
+DHT::DHT(uint8_t pin, uint8_t type, uint8_t) : pin_(pin), type_(type) {}
+
+void DHT::begin(uint8_t) { hasRead_ = false; }
+
+bool DHT::read(bool force)
+{
+  uint32_t now = millis();
+  if (!force && hasRead_ && (now - lastReadTime_) < 2000)
+    return lastResult_;
+  hasRead_ = true;
+  lastReadTime_ = now;
+
+  hostsim::Counters &c = hostsim::counters();
+  c.dhtTransactions++;
+  // the real driver runs the frame with interrupts disabled
+  hostsim::advanceMicros(hostsim::costs().dhtTransactionUs);
+
+  const hostsim::SensorFrame &s = hostsim::sensors();
+  lastResult_ = !s.dhtFails;
+  if (lastResult_)
+  {
+    // DHT11 resolution: whole %RH, 0.1 C
+    temperature_ = roundf(s.temperature * 10.0f) / 10.0f;
+    humidity_ = roundf(s.humidity);
+  }
+  return lastResult_;
+}
+
+float DHT::readTemperature(bool S, bool force)
+{
+  if (!read(force))
+    return NAN;
+  return S ? temperature_ * 1.8f + 32.0f : temperature_;
+}
+
+float DHT::readHumidity(bool force)
+{
+  if (!read(force))
+    return NAN;
+  return humidity_;
+}
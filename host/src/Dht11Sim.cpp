@@ -0,0 +1,125 @@
+// Line-level model of a DHT11 for the asynchronous reader. When the ESP32
+// releases the data line after holding it low for at least 18 ms, the answer
+// is queued as pin edges: 80 us low + 80 us high, then per bit 50 us low and
+// 27 us (0) or 70 us (1) high, then 50 us low. The bytes come from
+// hostsim::sensors() (whole %RH, 0.1 C) unless a recorded transaction is
+// waiting to be replayed.
+//
+// The Adafruit driver stand-in (DHT.cpp) does not use this model.
+
+#include <math.h>
+
+#include <vector>
+
+#include "HostSim.h"
+#include "SimDevices.h"
+
+namespace hostsim
+{
+  namespace
+  {
+    constexpr uint64_t START_PULSE_MIN_US = 18000;
+    constexpr uint32_t RESPONSE_DELAY_US = 30; // release to the sensor pulling low
+    constexpr uint32_t RESPONSE_LOW_US = 80;
+    constexpr uint32_t RESPONSE_HIGH_US = 80;
+    constexpr uint32_t BIT_LOW_US = 50;
+    constexpr uint32_t ZERO_HIGH_US = 27;
+    constexpr uint32_t ONE_HIGH_US = 70;
+    constexpr size_t FRAME_EDGES = 42;
+
+    uint8_t dhtPin = 14;
+    bool held = false;
+    uint64_t heldSinceUs = 0;
+
+    std::vector<std::vector<uint32_t>> replays;
+    size_t replayNext = 0;
+
+    // Falling-edge offsets from the release for the current sensor values;
+    // returns the number of edges (0: the sensor does not answer).
+    size_t synthesize(uint32_t *edges)
+    {
+      const SensorFrame &s = sensors();
+      if (s.dhtFails || isnan(s.temperature) || isnan(s.humidity))
+        return 0;
+
+      uint8_t data[5];
+      float humidity = roundf(fminf(fmaxf(s.humidity, 0.0f), 255.0f));
+      float tenths = roundf(s.temperature * 10.0f);
+      data[0] = (uint8_t)humidity;
+      data[1] = 0;
+      if (tenths >= 0)
+      {
+        data[2] = (uint8_t)fminf(tenths / 10, 255.0f);
+        data[3] = (uint8_t)((int)tenths % 10);
+      }
+      else
+      {
+        // the DHT11 sign encoding the Adafruit driver decodes: -1 - int + frac
+        int integral = (int)ceilf(-tenths / 10.0f) - 1;
+        data[2] = (uint8_t)integral;
+        data[3] = (uint8_t)(0x80 | (int)(tenths + 10 + integral * 10));
+      }
+      data[4] = (uint8_t)(data[0] + data[1] + data[2] + data[3]);
+
+      uint32_t t = RESPONSE_DELAY_US;
+      size_t count = 0;
+      edges[count++] = t;
+      t += RESPONSE_LOW_US + RESPONSE_HIGH_US;
+      edges[count++] = t;
+      for (int bit = 0; bit < 40; bit++)
+      {
+        bool one = data[bit / 8] & (0x80 >> (bit % 8));
+        t += BIT_LOW_US + (one ? ONE_HIGH_US : ZERO_HIGH_US);
+        edges[count++] = t;
+      }
+      return count;
+    }
+
+    void answer(uint64_t releasedUs)
+    {
+      counters().dhtTransactions++;
+      uint32_t synthesized[FRAME_EDGES];
+      const uint32_t *edges = synthesized;
+      size_t count;
+      if (replayNext < replays.size())
+      {
+        const std::vector<uint32_t> &recorded = replays[replayNext++];
+        edges = recorded.data();
+        count = recorded.size();
+      }
+      else
+      {
+        count = synthesize(synthesized);
+      }
+
+      for (size_t i = 0; i < count; i++)
+      {
+        detail::schedulePinEdge({releasedUs + edges[i], dhtPin, 0});
+        uint64_t riseUs = releasedUs + edges[i] + (i == 0 ? RESPONSE_LOW_US : BIT_LOW_US);
+        if (i + 1 == count || riseUs < releasedUs + edges[i + 1])
+          detail::schedulePinEdge({riseUs, dhtPin, 1});
+      }
+    }
+  }
+
+  void setDhtPin(uint8_t pin) { dhtPin = pin; }
+
+  void replayDhtTransaction(const uint32_t *fallingEdgesUs, size_t count)
+  {
+    replays.emplace_back(fallingEdgesUs, fallingEdgesUs + count);
+  }
+
+  namespace detail
+  {
+    void dhtLineHeld(uint8_t pin, bool low, uint64_t nowUs)
+    {
+      if (pin != dhtPin || low == held)
+        return;
+      held = low;
+      if (low)
+        heldSinceUs = nowUs;
+      else if (nowUs - heldSinceUs >= START_PULSE_MIN_US)
+        answer(nowUs);
+    }
+  }
+}
@@ -0,0 +1,11 @@
+#include "Esp.h"
+
+#include "HostSim.h"
+
+EspClass ESP;
+
+uint32_t EspClass::getHeapSize() { return (uint32_t)hostsim::heap().size; }
+uint32_t EspClass::getFreeHeap() { return (uint32_t)hostsim::heap().free; }
+uint32_t EspClass::getMinFreeHeap() { return (uint32_t)hostsim::heap().minFree; }
+uint32_t EspClass::getMaxAllocHeap() { return (uint32_t)hostsim::heap().largestBlock; }
+uint32_t EspClass::getCycleCount() { return (uint32_t)(hostsim::nowMicros() * getCpuFreqMHz()); }
@@ -0,0 +1,316 @@
+#include "freertos/task.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "HostHeap.h"
+#include "HostSim.h"
+#include "SimDevices.h"
+
+// A task is resumable from readyUs on; it resumes at the later of that and
+// its core's clock, so two tasks pinned to one core take turns while tasks on
+// different cores overlap in device time.
+struct HostTask
+{
+  TaskFunction_t code;
+  void *parameters;
+  const char *name;
+  UBaseType_t priority;
+  int core;
+  size_t index;
+  uint64_t readyUs = 0;
+  uint64_t wakeDueUs = 0; // scheduled wake-up of the running iteration
+  uint64_t iterationStartUs = 0;
+  bool finished = false;
+  std::condition_variable turn;
+};
+
+namespace
+{
+  constexpr int CORE_COUNT = 2;
+
+  struct Scheduler
+  {
+    std::mutex mutex;
+    std::condition_variable idle; // the harness waits here during runTasks()
+    std::vector<HostTask *> tasks;
+    HostTask *current = nullptr; // the only thread allowed to run; nullptr is the harness
+    bool running = false;
+    bool halted = false; // deep sleep: the run ended mid-iteration
+    uint64_t untilUs = 0;
+    uint64_t coreUs[CORE_COUNT] = {};
+    uint64_t stallFromUs = 0; // the last flash-cache stall
+    uint64_t stallUntilUs = 0;
+    hostsim::TaskHook hook = nullptr;
+  };
+
+  // Never destroyed: task threads stay parked in it after main() returns.
+  Scheduler &scheduler()
+  {
+    static Scheduler *instance = new Scheduler;
+    return *instance;
+  }
+
+  thread_local HostTask *self = nullptr;
+
+  uint64_t resumeAt(const Scheduler &s, const HostTask *task)
+  {
+    uint64_t core = s.coreUs[task->core];
+    uint64_t at = task->readyUs > core ? task->readyUs : core;
+    return at >= s.stallFromUs && at < s.stallUntilUs ? s.stallUntilUs : at;
+  }
+
+  // Gives the turn to the task that is furthest behind in device time (the
+  // caller keeps it on a tie), or back to the harness once every task has
+  // reached the end of the run. Called with the mutex held.
+  void dispatch(Scheduler &s)
+  {
+    HostTask *next = nullptr;
+    uint64_t nextUs = 0;
+    for (HostTask *task : s.tasks)
+    {
+      if (task->finished)
+        continue;
+      uint64_t at = resumeAt(s, task);
+      bool better = !next || at < nextUs ||
+                    (at == nextUs && next != s.current && (task == s.current || task->priority > next->priority));
+      if (better)
+      {
+        next = task;
+        nextUs = at;
+      }
+    }
+
+    if (!next || nextUs >= s.untilUs)
+    {
+      s.current = nullptr;
+      s.running = false;
+      s.idle.notify_one();
+      return;
+    }
+    s.coreUs[next->core] = nextUs;
+    s.current = next;
+    hostsim::detail::advanceSharedClock(nextUs);
+    next->turn.notify_one();
+  }
+
+  void waitTurn(Scheduler &s, HostTask *task, std::unique_lock<std::mutex> &lock)
+  {
+    while (s.current != task)
+      task->turn.wait(lock);
+  }
+
+  // Ends the calling task's iteration and parks it until wakeUs.
+  void sleepUntil(uint64_t wakeUs)
+  {
+    Scheduler &s = scheduler();
+    HostTask *task = self;
+    std::unique_lock<std::mutex> lock(s.mutex);
+    uint64_t now = s.coreUs[task->core];
+    if (s.hook)
+      s.hook(task->index, task->iterationStartUs - task->wakeDueUs, now - task->iterationStartUs);
+    task->readyUs = wakeUs > now ? wakeUs : now;
+    task->wakeDueUs = wakeUs;
+    dispatch(s);
+    waitTurn(s, task, lock);
+    task->iterationStartUs = s.coreUs[task->core];
+  }
+
+  [[noreturn]] void finishTask(HostTask *task)
+  {
+    Scheduler &s = scheduler();
+    std::unique_lock<std::mutex> lock(s.mutex);
+    task->finished = true;
+    if (s.current == task)
+      dispatch(s);
+    for (;;)
+      task->turn.wait(lock);
+  }
+
+  void taskThread(HostTask *task)
+  {
+    Scheduler &s = scheduler();
+    {
+      std::unique_lock<std::mutex> lock(s.mutex);
+      self = task;
+      waitTurn(s, task, lock);
+      task->iterationStartUs = task->wakeDueUs = s.coreUs[task->core];
+    }
+    try
+    {
+      task->code(task->parameters);
+    }
+    catch (...)
+    {
+    }
+    // a FreeRTOS task must not return; treat it as vTaskDelete(NULL)
+    finishTask(task);
+  }
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char *name, uint32_t, void *parameters,
+                                   UBaseType_t priority, TaskHandle_t *createdTask, BaseType_t coreId)
+{
+  // host bookkeeping, not device heap; a deep sleep leaves it behind parked
+  hostheap::Unaccounted unaccounted;
+  Scheduler &s = scheduler();
+  HostTask *task = new HostTask;
+  task->code = code;
+  task->parameters = parameters;
+  task->name = name;
+  task->priority = priority;
+  task->core = coreId >= 0 && coreId < CORE_COUNT ? (int)coreId : 0;
+  task->readyUs = hostsim::nowMicros();
+  {
+    std::lock_guard<std::mutex> lock(s.mutex);
+    task->index = s.tasks.size();
+    s.tasks.push_back(task);
+  }
+  std::thread(taskThread, task).detach();
+  if (createdTask)
+    *createdTask = task;
+  return pdPASS;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+  if (!self)
+    hostsim::advanceMicros((uint64_t)ticks * 1000);
+  else
+    sleepUntil(hostsim::nowMicros() + (uint64_t)ticks * 1000);
+}
+
+void vTaskDelayUntil(TickType_t *previousWakeTime, TickType_t increment)
+{
+  *previousWakeTime += increment;
+  uint64_t wakeUs = hostsim::detail::bootMicros() + (uint64_t)*previousWakeTime * 1000;
+  if (self)
+    sleepUntil(wakeUs);
+  else if (wakeUs > hostsim::nowMicros())
+    hostsim::advanceMicros(wakeUs - hostsim::nowMicros());
+}
+
+TickType_t xTaskGetTickCount()
+{
+  return (TickType_t)((hostsim::nowMicros() - hostsim::detail::bootMicros()) / 1000);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+  if (!task)
+  {
+    if (self)
+      finishTask(self);
+    return;
+  }
+  if (task == self)
+    finishTask(task);
+  std::lock_guard<std::mutex> lock(scheduler().mutex);
+  task->finished = true;
+}
+
+BaseType_t xPortGetCoreID() { return self ? self->core : 1; }
+
+namespace hostsim
+{
+  bool runTasks(uint64_t untilUs)
+  {
+    Scheduler &s = scheduler();
+    {
+      std::unique_lock<std::mutex> lock(s.mutex);
+      if (s.tasks.empty())
+        return false;
+      uint64_t now = nowMicros();
+      for (uint64_t &core : s.coreUs)
+        if (core < now)
+          core = now;
+      s.untilUs = untilUs;
+      s.running = true;
+      s.halted = false;
+      dispatch(s);
+      while (s.running)
+        s.idle.wait(lock);
+    }
+    if (!s.halted && nowMicros() < untilUs)
+      advanceMicros(untilUs - nowMicros());
+    return true;
+  }
+
+  size_t taskCount()
+  {
+    std::lock_guard<std::mutex> lock(scheduler().mutex);
+    return scheduler().tasks.size();
+  }
+
+  const char *taskName(size_t task) { return scheduler().tasks[task]->name; }
+  int taskCore(size_t task) { return scheduler().tasks[task]->core; }
+  void setTaskHook(TaskHook hook) { scheduler().hook = hook; }
+
+  namespace detail
+  {
+    bool inTask() { return self != nullptr; }
+
+    // Stops every task where it is; the calling one never returns.
+    void haltTasks()
+    {
+      Scheduler &s = scheduler();
+      HostTask *task = self;
+      std::unique_lock<std::mutex> lock(s.mutex);
+      for (HostTask *t : s.tasks)
+        t->finished = true;
+      s.halted = true;
+      s.current = nullptr;
+      s.running = false;
+      s.idle.notify_one();
+      for (;;)
+        task->turn.wait(lock);
+    }
+
+    // Forgets the halted tasks (their threads stay parked) so a new boot
+    // creates its own.
+    void resetTasks()
+    {
+      Scheduler &s = scheduler();
+      std::lock_guard<std::mutex> lock(s.mutex);
+      s.tasks.clear();
+      for (uint64_t &core : s.coreUs)
+        core = 0;
+      s.stallFromUs = s.stallUntilUs = 0;
+    }
+    uint64_t taskNowMicros() { return scheduler().coreUs[self->core]; }
+
+    // A task's clock may only run ahead of the others up to the point where
+    // one of them is due; then it yields mid-call, exactly as a blocking
+    // driver call would let the other core carry on.
+    void taskAdvanceMicros(uint64_t us)
+    {
+      Scheduler &s = scheduler();
+      HostTask *task = self;
+      std::unique_lock<std::mutex> lock(s.mutex);
+      s.coreUs[task->core] += us;
+      task->readyUs = s.coreUs[task->core];
+      dispatch(s);
+      waitTurn(s, task, lock);
+    }
+
+    void stallFlashCache(uint64_t us)
+    {
+      if (!inTask())
+      {
+        advanceMicros(us);
+        return;
+      }
+      Scheduler &s = scheduler();
+      HostTask *task = self;
+      std::unique_lock<std::mutex> lock(s.mutex);
+      s.stallFromUs = s.coreUs[task->core];
+      s.stallUntilUs = s.stallFromUs + us;
+      s.coreUs[task->core] = s.stallUntilUs;
+      task->readyUs = s.stallUntilUs;
+      dispatch(s);
+      waitTurn(s, task, lock);
+    }
+  }
+}
@@ -0,0 +1,104 @@
+// Counts every heap allocation made by the firmware and the stand-ins so the
+// benchmark can report allocations per cycle, and keeps the live total that
+// ESP.getFreeHeap() and friends report against a modeled ESP32 heap.
+
+#include "HostHeap.h"
+
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+
+#include "HostSim.h"
+
+namespace
+{
+  // Roughly what getHeapSize() reports on an ESP32 with Wi-Fi started. The
+  // host does not fragment, so the largest free block is all free memory.
+  constexpr size_t HEAP_SIZE = 320 * 1024;
+
+  // Prefixed to every block; 16 bytes keeps malloc's alignment.
+  struct BlockHeader
+  {
+    size_t size;
+    size_t accounted;
+  };
+
+  bool accounting = true;
+  size_t liveBytes = 0;
+  size_t peakLiveBytes = 0;
+
+  void *allocate(size_t size)
+  {
+    BlockHeader *header = (BlockHeader *)malloc(sizeof(BlockHeader) + size);
+    if (!header)
+      return nullptr;
+    header->size = size;
+    header->accounted = accounting;
+    if (accounting)
+    {
+      hostsim::Counters &c = hostsim::counters();
+      c.heapAllocs++;
+      c.heapBytes += size;
+      liveBytes += size;
+      if (liveBytes > peakLiveBytes)
+        peakLiveBytes = liveBytes;
+    }
+    return header + 1;
+  }
+
+  void release(void *p)
+  {
+    if (!p)
+      return;
+    BlockHeader *header = (BlockHeader *)p - 1;
+    if (header->accounted)
+      liveBytes -= header->size;
+    free(header);
+  }
+}
+
+void *hostheap::counted_realloc(void *ptr, size_t size)
+{
+  void *grown = allocate(size);
+  if (grown && ptr)
+  {
+    size_t old = ((BlockHeader *)ptr - 1)->size;
+    memcpy(grown, ptr, old < size ? old : size);
+    release(ptr);
+  }
+  return grown;
+}
+
+void hostheap::counted_free(void *ptr) { release(ptr); }
+
+hostheap::Unaccounted::Unaccounted() : saved_(accounting) { accounting = false; }
+hostheap::Unaccounted::~Unaccounted() { accounting = saved_; }
+
+namespace hostsim
+{
+  void setHeapAccounting(bool on) { accounting = on; }
+
+  HeapStats heap()
+  {
+    HeapStats stats;
+    stats.size = HEAP_SIZE;
+    stats.free = liveBytes < HEAP_SIZE ? HEAP_SIZE - liveBytes : 0;
+    stats.minFree = peakLiveBytes < HEAP_SIZE ? HEAP_SIZE - peakLiveBytes : 0;
+    stats.largestBlock = stats.free;
+    return stats;
+  }
+}
+
+void *operator new(size_t size)
+{
+  void *p = allocate(size);
+  if (!p)
+    throw std::bad_alloc();
+  return p;
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { release(p); }
+void operator delete[](void *p) noexcept { release(p); }
+void operator delete(void *p, size_t) noexcept { release(p); }
+void operator delete[](void *p, size_t) noexcept { release(p); }
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stddef.h>
+
+namespace hostheap
+{
+  // realloc()/free() that are counted in hostsim::counters() and the heap
+  // model like operator new/delete.
+  void *counted_realloc(void *ptr, size_t size);
+  void counted_free(void *ptr);
+
+  // Keeps allocations made in its scope out of the heap model, for
+  // stand-ins whose storage is not device RAM (the simulated flash).
+  class Unaccounted
+  {
+  public:
+    Unaccounted();
+    ~Unaccounted();
+
+  private:
+    bool saved_;
+  };
+}
@@ -0,0 +1,291 @@
+#include "HostSim.h"
+
+#include <string.h>
+
+#include "Arduino.h"
+#include "SimDevices.h"
+
+namespace hostsim
+{
+  namespace
+  {
+    uint64_t clockUs = 0;
+    uint64_t bootUs = 0;
+    CostModel costModel;
+    SensorFrame sensorFrame;
+    Counters counterSet;
+    bool echo = false;
+    ClockHook clockHook = nullptr;
+
+    constexpr int PIN_COUNT = 40;
+    int pinLevels[PIN_COUNT];
+    int pinOutputs[PIN_COUNT];
+    uint8_t pinModes[PIN_COUNT];
+    bool pinsInitialised = false;
+
+    constexpr size_t EDGE_QUEUE = 128; // a DHT11 frame is 84 edges
+    detail::PinEdge edgeQueue[EDGE_QUEUE];
+    size_t edgeHead = 0;
+    size_t edgeCount = 0;
+
+    bool wifiUp = true;
+    int32_t apChannel = 6;
+    const uint8_t apBssid[6] = {0x02, 0x1a, 0x11, 0xf0, 0x4c, 0x2e};
+    bool brokerUp = true;
+    PublishHook publishHook = nullptr;
+
+    constexpr size_t INBOX_DEPTH = 8;
+    constexpr size_t INBOX_TOPIC = 64;
+    constexpr size_t INBOX_PAYLOAD = 256;
+
+    struct InboundMessage
+    {
+      char topic[INBOX_TOPIC];
+      uint8_t payload[INBOX_PAYLOAD];
+      size_t length;
+    };
+
+    InboundMessage inbox[INBOX_DEPTH];
+    size_t inboxHead = 0;
+    size_t inboxCount = 0;
+
+    constexpr size_t RETAINED_DEPTH = 4;
+    InboundMessage retained[RETAINED_DEPTH];
+    size_t retainedCount = 0;
+
+    // A pin the ESP32 drives low (what the DHT11 sees as its start pulse).
+    void notifyLineHeld(uint8_t pin)
+    {
+      detail::dhtLineHeld(pin, pinModes[pin] == OUTPUT && pinOutputs[pin] == LOW, nowMicros());
+    }
+
+    void initPins()
+    {
+      if (pinsInitialised)
+        return;
+      for (int i = 0; i < PIN_COUNT; i++)
+      {
+        pinLevels[i] = 1; // idle high, as with INPUT_PULLUP
+        pinOutputs[i] = 0;
+        pinModes[i] = INPUT;
+      }
+      pinsInitialised = true;
+    }
+  }
+
+  uint64_t nowMicros() { return detail::inTask() ? detail::taskNowMicros() : clockUs; }
+  void advanceMicros(uint64_t us)
+  {
+    if (detail::inTask())
+      detail::taskAdvanceMicros(us);
+    else
+      detail::advanceSharedClock(clockUs + us);
+  }
+
+  void resetClock()
+  {
+    clockUs = 0;
+    bootUs = 0;
+  }
+  void setClockHook(ClockHook hook) { clockHook = hook; }
+
+  CostModel &costs() { return costModel; }
+  SensorFrame &sensors() { return sensorFrame; }
+
+  void setPinLevel(uint8_t pin, int level)
+  {
+    initPins();
+    if (pin >= PIN_COUNT || pinLevels[pin] == level)
+      return;
+    pinLevels[pin] = level;
+    // the level holds at once (ext0 sees it while asleep); the edge reaches
+    // any attached handler at the firmware's next clock or pin read
+    detail::schedulePinEdge({nowMicros(), pin, level});
+  }
+
+  int pinOutput(uint8_t pin)
+  {
+    initPins();
+    return pin < PIN_COUNT ? pinOutputs[pin] : 0;
+  }
+
+  void setWifiAvailable(bool up) { wifiUp = up; }
+  bool wifiAvailable() { return wifiUp; }
+  void setWifiChannel(int32_t channel) { apChannel = channel; }
+  int32_t wifiChannel() { return apChannel; }
+  const uint8_t *wifiBssid() { return apBssid; }
+  void setBrokerAvailable(bool up) { brokerUp = up; }
+  bool brokerAvailable() { return wifiUp && brokerUp; }
+
+  bool injectMqtt(const char *topic, const uint8_t *payload, size_t length)
+  {
+    if (inboxCount == INBOX_DEPTH || strlen(topic) >= INBOX_TOPIC || length > INBOX_PAYLOAD)
+      return false;
+    InboundMessage &msg = inbox[(inboxHead + inboxCount) % INBOX_DEPTH];
+    strcpy(msg.topic, topic);
+    memcpy(msg.payload, payload, length);
+    msg.length = length;
+    inboxCount++;
+    return true;
+  }
+
+  bool retainMqtt(const char *topic, const uint8_t *payload, size_t length)
+  {
+    if (strlen(topic) >= INBOX_TOPIC || length > INBOX_PAYLOAD)
+      return false;
+    size_t i = 0;
+    while (i < retainedCount && strcmp(retained[i].topic, topic) != 0)
+      i++;
+    if (length == 0)
+    {
+      if (i < retainedCount)
+        retained[i] = retained[--retainedCount];
+      return true;
+    }
+    if (i == retainedCount)
+    {
+      if (retainedCount == RETAINED_DEPTH)
+        return false;
+      retainedCount++;
+    }
+    strcpy(retained[i].topic, topic);
+    memcpy(retained[i].payload, payload, length);
+    retained[i].length = length;
+    return true;
+  }
+
+  void setPublishHook(PublishHook hook) { publishHook = hook; }
+
+  Counters &counters() { return counterSet; }
+  void resetCounters() { counterSet = Counters(); }
+
+  void setSerialEcho(bool on) { echo = on; }
+  bool serialEcho() { return echo; }
+
+  namespace detail
+  {
+    uint64_t bootMicros() { return bootUs; }
+    void setBootMicros(uint64_t us) { bootUs = us; }
+
+    void resetPinOutputs()
+    {
+      initPins();
+      for (int i = 0; i < PIN_COUNT; i++)
+      {
+        pinOutputs[i] = 0;
+        pinModes[i] = INPUT;
+      }
+      edgeHead = edgeCount = 0;
+    }
+
+    void advanceSharedClock(uint64_t toUs)
+    {
+      if (toUs > clockUs)
+      {
+        mpuClockAdvanced(clockUs, toUs);
+        clockUs = toUs;
+      }
+      if (clockHook)
+        clockHook(clockUs);
+    }
+
+    void chargeSerial(size_t bytes)
+    {
+      counterSet.serialBytes += bytes;
+      advanceMicros((uint64_t)bytes * 10 * 1000000 / costModel.serialBaud);
+    }
+
+    void chargeI2c(size_t bytes, uint32_t clockHz)
+    {
+      counterSet.i2cBytes += bytes;
+      // address byte + payload, 9 clocks per byte incl. ACK
+      advanceMicros((uint64_t)(bytes + 1) * 9 * 1000000 / clockHz);
+    }
+
+    int pinLevel(uint8_t pin)
+    {
+      initPins();
+      return pin < PIN_COUNT ? pinLevels[pin] : 0;
+    }
+
+    void setPinOutput(uint8_t pin, int level)
+    {
+      initPins();
+      if (pin >= PIN_COUNT)
+        return;
+      pinOutputs[pin] = level;
+      notifyLineHeld(pin);
+    }
+
+    void setPinMode(uint8_t pin, uint8_t mode)
+    {
+      initPins();
+      if (pin >= PIN_COUNT)
+        return;
+      pinModes[pin] = mode;
+      notifyLineHeld(pin);
+    }
+
+    bool schedulePinEdge(const PinEdge &edge)
+    {
+      if (edgeCount == EDGE_QUEUE || edge.pin >= PIN_COUNT)
+        return false;
+      // devices schedule ahead (a DHT11 frame) or behind (an MPU6050 sample
+      // time), so keep the queue in time order
+      size_t i = edgeCount;
+      while (i > 0 && edgeQueue[(edgeHead + i - 1) % EDGE_QUEUE].atUs > edge.atUs)
+      {
+        edgeQueue[(edgeHead + i) % EDGE_QUEUE] = edgeQueue[(edgeHead + i - 1) % EDGE_QUEUE];
+        i--;
+      }
+      edgeQueue[(edgeHead + i) % EDGE_QUEUE] = edge;
+      edgeCount++;
+      return true;
+    }
+
+    bool takePinEdge(uint64_t nowUs, PinEdge &edge)
+    {
+      if (edgeCount == 0 || edgeQueue[edgeHead].atUs > nowUs)
+        return false;
+      edge = edgeQueue[edgeHead];
+      edgeHead = (edgeHead + 1) % EDGE_QUEUE;
+      edgeCount--;
+      initPins();
+      pinLevels[edge.pin] = edge.level;
+      return true;
+    }
+
+    bool popInbound(char *topic, size_t topicSize, uint8_t *payload, size_t *length)
+    {
+      if (inboxCount == 0)
+        return false;
+      InboundMessage &msg = inbox[inboxHead];
+      strncpy(topic, msg.topic, topicSize - 1);
+      topic[topicSize - 1] = '\0';
+      memcpy(payload, msg.payload, msg.length);
+      *length = msg.length;
+      inboxHead = (inboxHead + 1) % INBOX_DEPTH;
+      inboxCount--;
+      return true;
+    }
+
+    // Same matching as PubSubClient::subscribed(): exact, or a trailing '#'.
+    void queueRetained(const char *filter)
+    {
+      size_t n = strlen(filter);
+      bool wildcard = n > 0 && filter[n - 1] == '#';
+      for (size_t i = 0; i < retainedCount; i++)
+      {
+        const InboundMessage &msg = retained[i];
+        if (wildcard ? strncmp(filter, msg.topic, n - 1) == 0 : strcmp(filter, msg.topic) == 0)
+          injectMqtt(msg.topic, msg.payload, msg.length);
+      }
+    }
+
+    void notifyPublish(const char *topic, const uint8_t *payload, size_t length, bool retained)
+    {
+      if (publishHook)
+        publishHook(topic, payload, length, retained);
+    }
+  }
+}
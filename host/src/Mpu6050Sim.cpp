@@ -0,0 +1,310 @@
+// Register-level model of the MPU6050 at 0x68: a write sets the register
+// pointer (and stores any following bytes), a read returns registers from the
+// pointer with auto-increment. Measurement registers are refreshed from
+// hostsim::sensors() on every read.
+//
+// The FIFO is filled as the virtual clock advances, at the rate set by
+// SMPLRT_DIV/CONFIG, from hostsim::sensors() or from a replayed FIFO dump.
+// Like the chip, FIFO_COUNT saturates at 1024 on overflow and burst reads of
+// FIFO_R_W keep popping the FIFO instead of incrementing the pointer.
+//
+// Motion detection follows the register map: each accelerometer sample goes
+// through the high-pass filter set by ACCEL_HPF, and while any axis exceeds
+// MOT_THR (2 mg per LSB at +-2 g) a counter runs; when it reaches MOT_DUR
+// (1 ms per LSB) the chip sets MOT_INT and, if enabled, pulses INT for 50 us.
+// A sample back under the threshold resets the counter. It is evaluated at
+// the FIFO sample rate, or at the 1 kHz accelerometer rate with the FIFO off.
+
+#include <math.h>
+#include <string.h>
+
+#include <vector>
+
+#include "HostSim.h"
+#include "SimDevices.h"
+
+namespace hostsim
+{
+  namespace
+  {
+    constexpr uint16_t MPU_ADDR = 0x68;
+    constexpr uint8_t REG_SMPLRT_DIV = 0x19;
+    constexpr uint8_t REG_CONFIG = 0x1A;
+    constexpr uint8_t REG_ACCEL_CONFIG = 0x1C;
+    constexpr uint8_t REG_MOT_THR = 0x1F;
+    constexpr uint8_t REG_MOT_DUR = 0x20;
+    constexpr uint8_t REG_FIFO_EN = 0x23;
+    constexpr uint8_t REG_INT_PIN_CFG = 0x37;
+    constexpr uint8_t REG_INT_ENABLE = 0x38;
+    constexpr uint8_t REG_INT_STATUS = 0x3A;
+    constexpr uint8_t ACCEL_XOUT_H = 0x3B;
+    constexpr uint8_t REG_USER_CTRL = 0x6A;
+    constexpr uint8_t REG_FIFO_COUNTH = 0x72;
+    constexpr uint8_t REG_FIFO_COUNTL = 0x73;
+    constexpr uint8_t REG_FIFO_R_W = 0x74;
+
+    constexpr size_t FIFO_CAPACITY = 1024;
+    constexpr size_t RECORD_SIZE = 12;
+
+    constexpr uint8_t INT_MOT = 0x40;        // INT_ENABLE / INT_STATUS
+    constexpr uint8_t INT_FIFO_OFLOW = 0x10; // INT_STATUS
+    constexpr uint8_t INT_LEVEL_LOW = 0x80;  // INT_PIN_CFG: active low
+    constexpr uint32_t INT_PULSE_US = 50;    // INT_PIN_CFG LATCH_INT_EN clear
+    constexpr uint64_t ACCEL_RATE_US = 1000; // 1 kHz accelerometer output
+    constexpr float COUNTS_PER_MG = 16.384f; // +-2 g full scale
+
+    uint8_t registers[128];
+    uint8_t pointer = 0;
+
+    uint8_t fifo[FIFO_CAPACITY];
+    size_t fifoHead = 0;
+    size_t fifoCount = 0;
+    bool fifoOverflow = false;
+    uint64_t nextSampleUs = 0;
+
+    std::vector<uint8_t> replay;
+    size_t replayOffset = 0;
+
+    uint8_t intPin = 27;
+    uint8_t motionStatus = 0;
+    bool hpfPrimed = false;
+    float hpfBaseline[3];
+    uint64_t motionCountUs = 0;
+    bool motionFired = false;
+
+    void putWord(uint8_t *p, int16_t value)
+    {
+      p[0] = (uint8_t)((uint16_t)value >> 8);
+      p[1] = (uint8_t)value;
+    }
+
+    void latchMeasurements()
+    {
+      const SensorFrame &s = sensors();
+      putWord(&registers[ACCEL_XOUT_H], s.accel[0]);
+      putWord(&registers[ACCEL_XOUT_H + 2], s.accel[1]);
+      putWord(&registers[ACCEL_XOUT_H + 4], s.accel[2]);
+      putWord(&registers[ACCEL_XOUT_H + 6], 0); // die temperature, unused
+      putWord(&registers[ACCEL_XOUT_H + 8], s.gyro[0]);
+      putWord(&registers[ACCEL_XOUT_H + 10], s.gyro[1]);
+      putWord(&registers[ACCEL_XOUT_H + 12], s.gyro[2]);
+    }
+
+    bool fifoEnabled() { return (registers[REG_USER_CTRL] & 0x40) && (registers[REG_FIFO_EN] & 0x78) == 0x78; }
+
+    uint64_t samplePeriodUs()
+    {
+      uint8_t dlpf = registers[REG_CONFIG] & 0x07;
+      uint32_t gyroRate = (dlpf == 0 || dlpf == 7) ? 8000 : 1000;
+      return 1000000ULL * (1 + registers[REG_SMPLRT_DIV]) / gyroRate;
+    }
+
+    void resetFifo()
+    {
+      fifoHead = fifoCount = 0;
+      fifoOverflow = false;
+    }
+
+    bool motionInterruptEnabled() { return registers[REG_INT_ENABLE] & INT_MOT; }
+
+    // The replay only feeds the FIFO; with it off, samples come from sensors().
+    void nextRecord(uint8_t *record)
+    {
+      if (fifoEnabled() && replayOffset + RECORD_SIZE <= replay.size())
+      {
+        memcpy(record, &replay[replayOffset], RECORD_SIZE);
+        replayOffset += RECORD_SIZE;
+        return;
+      }
+      const SensorFrame &s = sensors();
+      for (int i = 0; i < 3; i++)
+      {
+        putWord(&record[2 * i], s.accel[i]);
+        putWord(&record[6 + 2 * i], s.gyro[i]);
+      }
+    }
+
+    // INT idles at the inactive level of INT_PIN_CFG.
+    void driveIntPin(uint64_t atUs, bool active)
+    {
+      bool high = active != ((registers[REG_INT_PIN_CFG] & INT_LEVEL_LOW) != 0);
+      detail::schedulePinEdge({atUs, intPin, high ? 1 : 0});
+    }
+
+    void detectMotion(const uint8_t *record, uint64_t atUs, uint64_t periodUs)
+    {
+      float accel[3];
+      for (int i = 0; i < 3; i++)
+        accel[i] = (float)(int16_t)(record[2 * i] << 8 | record[2 * i + 1]);
+      if (!hpfPrimed)
+      {
+        memcpy(hpfBaseline, accel, sizeof(hpfBaseline));
+        hpfPrimed = true;
+      }
+
+      // ACCEL_HPF: 1..4 = 5, 2.5, 1.25, 0.63 Hz, 7 = hold the baseline,
+      // 0 = no filter
+      uint8_t hpf = registers[REG_ACCEL_CONFIG] & 0x07;
+      float alpha = 0.0f;
+      if (hpf >= 1 && hpf <= 4)
+        alpha = 1.0f - expf(-2.0f * (float)M_PI * (5.0f / (float)(1 << (hpf - 1))) * periodUs / 1e6f);
+      float threshold = registers[REG_MOT_THR] * 2 * COUNTS_PER_MG;
+      bool over = false;
+      for (int i = 0; i < 3; i++)
+      {
+        float filtered = hpf == 0 ? accel[i] : accel[i] - hpfBaseline[i];
+        hpfBaseline[i] += alpha * (accel[i] - hpfBaseline[i]);
+        if (fabsf(filtered) > threshold)
+          over = true;
+      }
+
+      if (!over)
+      {
+        motionCountUs = 0;
+        motionFired = false;
+        return;
+      }
+      motionCountUs += periodUs;
+      if (motionFired || motionCountUs < (uint64_t)registers[REG_MOT_DUR] * 1000)
+        return;
+      motionFired = true;
+      motionStatus = INT_MOT;
+      driveIntPin(atUs, true);
+      driveIntPin(atUs + INT_PULSE_US, false);
+    }
+
+    void pushRecord(const uint8_t *record)
+    {
+      for (size_t i = 0; i < RECORD_SIZE; i++)
+      {
+        if (fifoCount == FIFO_CAPACITY)
+        {
+          // the chip overwrites the oldest data on overflow
+          fifoHead = (fifoHead + 1) % FIFO_CAPACITY;
+          fifoCount--;
+          fifoOverflow = true;
+        }
+        fifo[(fifoHead + fifoCount) % FIFO_CAPACITY] = record[i];
+        fifoCount++;
+      }
+    }
+
+    uint8_t popFifo()
+    {
+      if (fifoCount == 0)
+        return 0;
+      uint8_t b = fifo[fifoHead];
+      fifoHead = (fifoHead + 1) % FIFO_CAPACITY;
+      fifoCount--;
+      return b;
+    }
+
+    uint8_t readRegister(uint8_t reg)
+    {
+      switch (reg)
+      {
+      case REG_FIFO_COUNTH:
+        return (uint8_t)(fifoCount >> 8);
+      case REG_FIFO_COUNTL:
+        return (uint8_t)fifoCount;
+      case REG_INT_STATUS:
+      {
+        uint8_t status = (fifoOverflow ? INT_FIFO_OFLOW : 0) | motionStatus;
+        fifoOverflow = false;
+        motionStatus = 0;
+        return status;
+      }
+      default:
+        return registers[reg & 0x7F];
+      }
+    }
+  }
+
+  void replayFifo(const uint8_t *records, size_t length)
+  {
+    replay.assign(records, records + length);
+    replayOffset = 0;
+  }
+
+  void setMpuIntPin(uint8_t pin) { intPin = pin; }
+
+  namespace detail
+  {
+    void mpuClockAdvanced(uint64_t fromUs, uint64_t toUs)
+    {
+      bool fifo = fifoEnabled();
+      bool motion = motionInterruptEnabled();
+      if (!(fifo || motion) || sensors().mpuFails)
+      {
+        nextSampleUs = toUs;
+        hpfPrimed = false;
+        return;
+      }
+      uint64_t period = fifo ? samplePeriodUs() : ACCEL_RATE_US;
+      if (nextSampleUs < fromUs)
+        nextSampleUs = fromUs;
+      // past a full FIFO only the newest records survive; motion detection
+      // still sees every sample
+      uint64_t pending = toUs > nextSampleUs ? (toUs - nextSampleUs + period - 1) / period : 0;
+      uint64_t keep = FIFO_CAPACITY / RECORD_SIZE + 1;
+      uint64_t keepFromUs = nextSampleUs;
+      if (pending > keep)
+      {
+        fifoOverflow = fifoOverflow || fifo;
+        keepFromUs += (pending - keep) * period;
+        if (!motion)
+          nextSampleUs = keepFromUs;
+      }
+      while (nextSampleUs < toUs)
+      {
+        uint8_t record[RECORD_SIZE];
+        nextRecord(record);
+        if (fifo && nextSampleUs >= keepFromUs)
+          pushRecord(record);
+        if (motion)
+          detectMotion(record, nextSampleUs, period);
+        nextSampleUs += period;
+      }
+    }
+
+    bool i2cWrite(uint16_t address, const uint8_t *data, size_t length)
+    {
+      if (address != MPU_ADDR || sensors().mpuFails)
+        return false;
+      if (length == 0)
+        return true;
+      pointer = data[0] & 0x7F;
+      for (size_t i = 1; i < length; i++)
+      {
+        uint8_t reg = (pointer + i - 1) & 0x7F;
+        registers[reg] = data[i];
+        if (reg == REG_USER_CTRL && (data[i] & 0x04))
+        {
+          resetFifo();
+          registers[reg] &= (uint8_t)~0x04; // self-clearing
+        }
+        if (reg == REG_INT_PIN_CFG || reg == REG_INT_ENABLE)
+          driveIntPin(nowMicros(), false);
+      }
+      return true;
+    }
+
+    size_t i2cRead(uint16_t address, uint8_t *data, size_t length)
+    {
+      if (address != MPU_ADDR || sensors().mpuFails)
+        return 0;
+      latchMeasurements();
+      for (size_t i = 0; i < length; i++)
+      {
+        if (pointer == REG_FIFO_R_W)
+        {
+          data[i] = popFifo();
+          continue;
+        }
+        data[i] = readRegister(pointer);
+        pointer = (pointer + 1) & 0x7F;
+      }
+      return length;
+    }
+  }
+}
@@ -0,0 +1,84 @@
+#include "esp_partition.h"
+
+#include <string.h>
+#include <vector>
+
+#include "HostHeap.h"
+#include "HostSim.h"
+#include "SimDevices.h"
+
+namespace
+{
+  // The data partitions of partitions.csv the firmware opens by label.
+  esp_partition_t table[] = {
+      {ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)0x40, 0x3E0000, 0x10000, "journal", false},
+  };
+  constexpr size_t PARTITION_COUNT = sizeof(table) / sizeof(table[0]);
+
+  std::vector<uint8_t> &contents(const esp_partition_t *partition)
+  {
+    static std::vector<uint8_t> flash[PARTITION_COUNT];
+    std::vector<uint8_t> &bytes = flash[partition - table];
+    if (bytes.empty())
+    {
+      hostheap::Unaccounted chip;
+      bytes.assign(partition->size, 0xFF); // shipped erased
+    }
+    return bytes;
+  }
+
+  bool known(const esp_partition_t *partition)
+  {
+    return partition >= table && partition < table + PARTITION_COUNT;
+  }
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label)
+{
+  for (esp_partition_t &partition : table)
+  {
+    if (partition.type == type && (subtype == ESP_PARTITION_SUBTYPE_ANY || partition.subtype == subtype) &&
+        (!label || strcmp(partition.label, label) == 0))
+      return &partition;
+  }
+  return nullptr;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t srcOffset, void *dst, size_t size)
+{
+  if (!known(partition) || srcOffset + size > partition->size)
+    return ESP_ERR_INVALID_SIZE;
+  memcpy(dst, contents(partition).data() + srcOffset, size);
+  hostsim::advanceMicros(hostsim::costs().flashReadUs);
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dstOffset, const void *src, size_t size)
+{
+  if (!known(partition) || dstOffset + size > partition->size)
+    return ESP_ERR_INVALID_SIZE;
+  uint8_t *flash = contents(partition).data() + dstOffset;
+  const uint8_t *bytes = (const uint8_t *)src;
+  for (size_t i = 0; i < size; i++)
+    flash[i] &= bytes[i];
+  hostsim::Counters &c = hostsim::counters();
+  c.flashWrites++;
+  c.flashBytesWritten += size;
+  const hostsim::CostModel &cost = hostsim::costs();
+  hostsim::detail::stallFlashCache(cost.flashProgramUs + (uint64_t)size * cost.flashWriteNsPerByte / 1000);
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+  if (!known(partition) || offset % SPI_FLASH_SEC_SIZE || size % SPI_FLASH_SEC_SIZE)
+    return ESP_ERR_INVALID_ARG;
+  if (offset + size > partition->size)
+    return ESP_ERR_INVALID_SIZE;
+  memset(contents(partition).data() + offset, 0xFF, size);
+  size_t sectors = size / SPI_FLASH_SEC_SIZE;
+  hostsim::counters().flashErases += sectors;
+  hostsim::detail::stallFlashCache((uint64_t)sectors * hostsim::costs().flashEraseUs);
+  return ESP_OK;
+}
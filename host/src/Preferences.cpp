@@ -0,0 +1,99 @@
+#include "Preferences.h"
+
+#include <map>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "HostHeap.h"
+#include "HostSim.h"
+#include "SimDevices.h"
+
+namespace
+{
+  constexpr size_t NAME_MAX_LENGTH = 15; // NVS namespace and key limit
+
+  std::map<std::string, std::vector<uint8_t>> &entries()
+  {
+    static std::map<std::string, std::vector<uint8_t>> table;
+    return table;
+  }
+
+  std::string entryName(const char *space, const char *key) { return std::string(space) + '/' + key; }
+}
+
+bool Preferences::begin(const char *name, bool readOnly, const char *)
+{
+  if (!name || strlen(name) > NAME_MAX_LENGTH)
+    return false;
+  if (readOnly)
+  {
+    // like nvs_open(): a namespace is created by its first write
+    hostheap::Unaccounted flash;
+    std::string prefix = std::string(name) + '/';
+    auto it = entries().lower_bound(prefix);
+    if (it == entries().end() || it->first.compare(0, prefix.size(), prefix) != 0)
+      return false;
+  }
+  strcpy(namespace_, name);
+  readOnly_ = readOnly;
+  open_ = true;
+  return true;
+}
+
+void Preferences::end() { open_ = false; }
+
+bool Preferences::isKey(const char *key)
+{
+  if (!open_)
+    return false;
+  hostheap::Unaccounted flash;
+  return entries().count(entryName(namespace_, key)) != 0;
+}
+
+bool Preferences::remove(const char *key)
+{
+  if (!open_ || readOnly_)
+    return false;
+  hostheap::Unaccounted flash;
+  return entries().erase(entryName(namespace_, key)) != 0;
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t length)
+{
+  if (!open_ || readOnly_ || !key || strlen(key) > NAME_MAX_LENGTH)
+    return 0;
+  {
+    hostheap::Unaccounted flash;
+    const uint8_t *bytes = (const uint8_t *)value;
+    entries()[entryName(namespace_, key)].assign(bytes, bytes + length);
+  }
+  hostsim::Counters &c = hostsim::counters();
+  c.flashWrites++;
+  c.flashBytesWritten += length;
+  const hostsim::CostModel &cost = hostsim::costs();
+  hostsim::detail::stallFlashCache(cost.flashWriteUs + (uint64_t)length * cost.flashWriteNsPerByte / 1000);
+  return length;
+}
+
+size_t Preferences::getBytesLength(const char *key)
+{
+  if (!open_)
+    return 0;
+  hostheap::Unaccounted flash;
+  auto it = entries().find(entryName(namespace_, key));
+  return it == entries().end() ? 0 : it->second.size();
+}
+
+size_t Preferences::getBytes(const char *key, void *buffer, size_t maxLength)
+{
+  if (!open_)
+    return 0;
+  hostheap::Unaccounted flash;
+  auto it = entries().find(entryName(namespace_, key));
+  if (it == entries().end() || it->second.size() > maxLength)
+    return 0;
+  memcpy(buffer, it->second.data(), it->second.size());
+  hostsim::advanceMicros(hostsim::costs().flashReadUs);
+  return it->second.size();
+}
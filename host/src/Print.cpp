@@ -0,0 +1,64 @@
+#include "Print.h"
+
+#include <stdio.h>
+
+#include "HostHeap.h"
+#include "WString.h"
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+  size_t n = 0;
+  while (size--)
+    n += write(*buffer++);
+  return n;
+}
+
+// Same buffering as arduino-esp32: lines that don't fit the 64-byte stack
+// buffer are formatted into a heap allocation.
+size_t Print::printf(const char *format, ...)
+{
+  char local[64];
+  char *buf = local;
+  va_list args;
+  va_start(args, format);
+  va_list copy;
+  va_copy(copy, args);
+  int len = vsnprintf(local, sizeof(local), format, copy);
+  va_end(copy);
+  if (len < 0)
+  {
+    va_end(args);
+    return 0;
+  }
+  if ((size_t)len >= sizeof(local))
+  {
+    buf = (char *)hostheap::counted_realloc(nullptr, (size_t)len + 1);
+    if (!buf)
+    {
+      va_end(args);
+      return 0;
+    }
+    vsnprintf(buf, (size_t)len + 1, format, args);
+  }
+  va_end(args);
+  size_t written = write((const uint8_t *)buf, (size_t)len);
+  if (buf != local)
+    hostheap::counted_free(buf);
+  return written;
+}
+
+size_t Print::print(const String &s) { return write((const uint8_t *)s.c_str(), s.length()); }
+
+size_t Print::print(long n, int base)
+{
+  if (base == DEC)
+    return printf("%ld", n);
+  return print((unsigned long)n, base);
+}
+
+size_t Print::print(unsigned long n, int base)
+{
+  return printf(base == HEX ? "%lx" : "%lu", n);
+}
+
+size_t Print::print(double n, int digits) { return printf("%.*f", digits, n); }
@@ -0,0 +1,140 @@
+#include "PubSubClient.h"
+
+#include <string.h>
+
+#include "HostSim.h"
+#include "SimDevices.h"
+#include "WiFi.h"
+
+PubSubClient::PubSubClient(WiFiClient &client) : client_(client) {}
+
+PubSubClient &PubSubClient::setServer(const char *, uint16_t) { return *this; }
+
+PubSubClient &PubSubClient::setCallback(MQTT_CALLBACK_SIGNATURE)
+{
+  callback_ = callback;
+  return *this;
+}
+
+bool PubSubClient::setBufferSize(uint16_t size)
+{
+  if (size == 0)
+    return false;
+  bufferSize_ = size;
+  return true;
+}
+
+bool PubSubClient::connect(const char *id) { return connect(id, nullptr, 0, false, nullptr); }
+
+bool PubSubClient::connect(const char *, const char *, uint8_t, bool, const char *)
+{
+  hostsim::counters().mqttConnects++;
+  if (WiFi.status() != WL_CONNECTED)
+  {
+    state_ = MQTT_CONNECT_FAILED; // no route, fails at once
+    return false;
+  }
+  if (!hostsim::brokerAvailable())
+  {
+    // SYN retransmits to a silent broker host until the WiFiClient's connect
+    // timeout; PubSubClient's socket timeout only covers the CONNACK wait
+    hostsim::advanceMicros((uint64_t)client_.timeoutMs() * 1000);
+    state_ = MQTT_CONNECT_FAILED;
+    return false;
+  }
+  hostsim::advanceMicros(hostsim::costs().mqttConnectUs);
+  subscriptionCount_ = 0;
+  state_ = MQTT_CONNECTED;
+  return true;
+}
+
+void PubSubClient::disconnect() { state_ = MQTT_DISCONNECTED; }
+
+bool PubSubClient::connected()
+{
+  if (state_ == MQTT_CONNECTED && (WiFi.status() != WL_CONNECTED || !hostsim::brokerAvailable()))
+    state_ = MQTT_CONNECTION_LOST;
+  return state_ == MQTT_CONNECTED;
+}
+
+bool PubSubClient::publish(const char *topic, const char *payload)
+{
+  return publish(topic, (const uint8_t *)payload, payload ? (unsigned int)strlen(payload) : 0, false);
+}
+
+bool PubSubClient::publish(const char *topic, const char *payload, bool retained)
+{
+  return publish(topic, (const uint8_t *)payload, payload ? (unsigned int)strlen(payload) : 0, retained);
+}
+
+bool PubSubClient::publish(const char *topic, const uint8_t *payload, unsigned int plength)
+{
+  return publish(topic, payload, plength, false);
+}
+
+bool PubSubClient::publish(const char *topic, const uint8_t *payload, unsigned int plength, bool retained)
+{
+  hostsim::Counters &c = hostsim::counters();
+  size_t topicLength = strlen(topic);
+  size_t remaining = 2 + topicLength + plength;
+  // PubSubClient reserves 5 bytes for the fixed header in its buffer
+  if (!connected() || remaining + 5 > bufferSize_)
+  {
+    c.publishFailures++;
+    return false;
+  }
+
+  size_t header = 2;
+  for (size_t r = remaining; r > 127; r >>= 7)
+    header++;
+  size_t packet = header + remaining;
+
+  c.publishes++;
+  c.mqttBytes += packet;
+  const hostsim::CostModel &cost = hostsim::costs();
+  hostsim::advanceMicros(cost.mqttPublishBaseUs + (uint64_t)packet * 1000 / cost.mqttBytesPerMs);
+  hostsim::detail::notifyPublish(topic, payload, plength, retained);
+  return true;
+}
+
+bool PubSubClient::subscribe(const char *topic, uint8_t)
+{
+  if (!connected() || subscriptionCount_ == MAX_SUBSCRIPTIONS || strlen(topic) >= MAX_TOPIC)
+    return false;
+  strcpy(subscriptions_[subscriptionCount_++], topic);
+  hostsim::detail::queueRetained(topic); // the broker sends retained messages on SUBSCRIBE
+  return true;
+}
+
+bool PubSubClient::subscribed(const char *topic) const
+{
+  for (int i = 0; i < subscriptionCount_; i++)
+  {
+    const char *filter = subscriptions_[i];
+    size_t n = strlen(filter);
+    if (n > 0 && filter[n - 1] == '#')
+    {
+      if (strncmp(filter, topic, n - 1) == 0)
+        return true;
+    }
+    else if (strcmp(filter, topic) == 0)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool PubSubClient::loop()
+{
+  if (!connected())
+    return false;
+  hostsim::advanceMicros(hostsim::costs().mqttLoopUs);
+
+  char topic[MAX_TOPIC];
+  uint8_t payload[MQTT_MAX_PACKET_SIZE];
+  size_t length;
+  if (hostsim::detail::popInbound(topic, sizeof(topic), payload, &length) && subscribed(topic) && callback_)
+    callback_(topic, payload, (unsigned int)length);
+  return true;
+}
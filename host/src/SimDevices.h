@@ -0,0 +1,62 @@
+#pragma once
+
+// Internal interface between the host stand-ins and the simulated devices.
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace hostsim
+{
+  namespace detail
+  {
+    int pinLevel(uint8_t pin);
+    void setPinOutput(uint8_t pin, int level);
+    void setPinMode(uint8_t pin, uint8_t mode);
+
+    // Level changes driven by a simulated device or the harness, queued in
+    // time order. The Arduino stand-in applies them, and runs any attached
+    // interrupt handler, when the firmware next reads the clock or a pin.
+    struct PinEdge
+    {
+      uint64_t atUs;
+      uint8_t pin;
+      int level;
+    };
+    bool schedulePinEdge(const PinEdge &edge);
+    bool takePinEdge(uint64_t nowUs, PinEdge &edge);
+    void resetInterrupts();
+
+    // The DHT11 model watches its pin for the start pulse.
+    void dhtLineHeld(uint8_t pin, bool low, uint64_t nowUs);
+
+    // A flash write or erase: the caller spends us of device time, and, as
+    // the cache is disabled meanwhile, no task on either core resumes before
+    // it ends.
+    void stallFlashCache(uint64_t us);
+
+    bool popInbound(char *topic, size_t topicSize, uint8_t *payload, size_t *length);
+    void queueRetained(const char *filter);
+    void notifyPublish(const char *topic, const uint8_t *payload, size_t length, bool retained);
+
+    // I2C bus: returns false (NACK) if no device answers at the address.
+    bool i2cWrite(uint16_t address, const uint8_t *data, size_t length);
+    size_t i2cRead(uint16_t address, uint8_t *data, size_t length);
+
+    // Lets the MPU6050 model fill its FIFO for the elapsed device time.
+    void mpuClockAdvanced(uint64_t fromUs, uint64_t toUs);
+
+    // Task scheduler (FreeRTOS.cpp): on a task thread the clock is that of
+    // the task's core, and the shared clock follows the slowest core.
+    bool inTask();
+    uint64_t taskNowMicros();
+    void taskAdvanceMicros(uint64_t us);
+    void advanceSharedClock(uint64_t toUs);
+
+    // Deep sleep and reboot (Sleep.cpp).
+    [[noreturn]] void haltTasks();
+    void resetTasks();
+    void resetPinOutputs();
+    uint64_t bootMicros(); // clock at the last boot; millis() counts from here
+    void setBootMicros(uint64_t us);
+  }
+}
@@ -0,0 +1,98 @@
+#include "esp_sleep.h"
+
+#include "HostSim.h"
+#include "SimDevices.h"
+#include "WiFi.h"
+#include "driver/rtc_io.h"
+
+namespace
+{
+  int ext0Pin = -1;
+  int ext0Level = 0;
+  uint64_t timerUs = 0;
+  bool pending = false;
+  uint64_t sleptAtUs = 0;
+  esp_sleep_wakeup_cause_t wakeCause = ESP_SLEEP_WAKEUP_UNDEFINED;
+}
+
+esp_err_t esp_sleep_enable_ext0_wakeup(gpio_num_t gpio, int level)
+{
+  if (gpio < 0 || gpio >= GPIO_NUM_MAX)
+    return ESP_ERR_INVALID_ARG;
+  ext0Pin = gpio;
+  ext0Level = level ? 1 : 0;
+  return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t timeUs)
+{
+  timerUs = timeUs;
+  return ESP_OK;
+}
+
+void esp_deep_sleep_start()
+{
+  pending = true;
+  sleptAtUs = hostsim::nowMicros();
+  hostsim::counters().deepSleeps++;
+  if (hostsim::detail::inTask())
+    hostsim::detail::haltTasks();
+  throw hostsim::DeepSleep();
+}
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause() { return wakeCause; }
+
+esp_err_t rtc_gpio_pullup_en(gpio_num_t gpio) { return gpio >= 0 && gpio < GPIO_NUM_MAX ? ESP_OK : ESP_ERR_INVALID_ARG; }
+esp_err_t rtc_gpio_pulldown_dis(gpio_num_t gpio) { return rtc_gpio_pullup_en(gpio); }
+
+namespace hostsim
+{
+  bool deepSleepPending() { return pending; }
+
+  bool sleepUntilWake(uint64_t untilUs)
+  {
+    // a task on the other core may have been behind the one that slept
+    if (nowMicros() < sleptAtUs)
+      advanceMicros(sleptAtUs - nowMicros());
+    uint64_t timerDueUs = timerUs ? sleptAtUs + timerUs : UINT64_MAX;
+    bool woke = false;
+    for (;;)
+    {
+      uint64_t now = nowMicros();
+      if (ext0Pin >= 0 && detail::pinLevel((uint8_t)ext0Pin) == ext0Level)
+      {
+        wakeCause = ESP_SLEEP_WAKEUP_EXT0;
+        woke = true;
+        break;
+      }
+      if (now >= timerDueUs)
+      {
+        wakeCause = ESP_SLEEP_WAKEUP_TIMER;
+        woke = true;
+        break;
+      }
+      if (now >= untilUs)
+        break;
+      uint64_t step = 1000; // the ext0 level is sampled every millisecond
+      if (timerDueUs - now < step)
+        step = timerDueUs - now;
+      if (untilUs - now < step)
+        step = untilUs - now;
+      advanceMicros(step);
+    }
+    counters().sleepUs += nowMicros() - sleptAtUs;
+    return woke;
+  }
+
+  void reboot()
+  {
+    pending = false;
+    ext0Pin = -1;
+    timerUs = 0;
+    detail::resetTasks();
+    detail::resetPinOutputs();
+    detail::resetInterrupts();
+    WiFi = WiFiClass();
+    detail::setBootMicros(nowMicros());
+  }
+}
@@ -0,0 +1,143 @@
+#include "WString.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "HostHeap.h"
+
+String::String(const char *cstr) { assign(cstr ? cstr : "", cstr ? (unsigned int)strlen(cstr) : 0); }
+
+String::String(const String &other) { assign(other.c_str(), other.len_); }
+
+String::String(String &&other) noexcept
+    : ptr_(other.ptr_), cap_(other.cap_), len_(other.len_)
+{
+  memcpy(sso_, other.sso_, sizeof(sso_));
+  other.ptr_ = nullptr;
+  other.cap_ = SSO_SIZE;
+  other.len_ = 0;
+  other.sso_[0] = '\0';
+}
+
+String::String(char c) { assign(&c, 1); }
+
+String::String(int value, unsigned char base) : String((long)value, base) {}
+String::String(unsigned int value, unsigned char base) : String((unsigned long)value, base) {}
+
+String::String(long value, unsigned char base)
+{
+  char buf[24];
+  if (base == 16)
+    snprintf(buf, sizeof(buf), "%lx", (unsigned long)value);
+  else
+    snprintf(buf, sizeof(buf), "%ld", value);
+  assign(buf, (unsigned int)strlen(buf));
+}
+
+String::String(unsigned long value, unsigned char base)
+{
+  char buf[24];
+  snprintf(buf, sizeof(buf), base == 16 ? "%lx" : "%lu", value);
+  assign(buf, (unsigned int)strlen(buf));
+}
+
+String::String(float value, unsigned int decimalPlaces) : String((double)value, decimalPlaces) {}
+
+String::String(double value, unsigned int decimalPlaces)
+{
+  char buf[48];
+  snprintf(buf, sizeof(buf), "%.*f", (int)decimalPlaces, value);
+  assign(buf, (unsigned int)strlen(buf));
+}
+
+String::~String() { release(); }
+
+String &String::operator=(const String &rhs)
+{
+  if (this != &rhs)
+    assign(rhs.c_str(), rhs.len_);
+  return *this;
+}
+
+String &String::operator=(String &&rhs) noexcept
+{
+  if (this != &rhs)
+  {
+    release();
+    ptr_ = rhs.ptr_;
+    cap_ = rhs.cap_;
+    len_ = rhs.len_;
+    memcpy(sso_, rhs.sso_, sizeof(sso_));
+    rhs.ptr_ = nullptr;
+    rhs.cap_ = SSO_SIZE;
+    rhs.len_ = 0;
+    rhs.sso_[0] = '\0';
+  }
+  return *this;
+}
+
+String &String::operator=(const char *cstr)
+{
+  assign(cstr ? cstr : "", cstr ? (unsigned int)strlen(cstr) : 0);
+  return *this;
+}
+
+String &String::operator+=(const char *cstr)
+{
+  return cstr ? concat(cstr, (unsigned int)strlen(cstr)) : *this;
+}
+
+bool String::operator==(const String &rhs) const
+{
+  return len_ == rhs.len_ && memcmp(c_str(), rhs.c_str(), len_) == 0;
+}
+
+bool String::operator==(const char *cstr) const
+{
+  return cstr && strcmp(c_str(), cstr) == 0;
+}
+
+bool String::reserve(unsigned int size)
+{
+  if (size <= cap_)
+    return true;
+  // arduino-esp32 reallocates to the exact requested size
+  char *grown = (char *)hostheap::counted_realloc(ptr_, size + 1);
+  if (!grown)
+    return false;
+  if (isSSO())
+    memcpy(grown, sso_, len_ + 1);
+  ptr_ = grown;
+  cap_ = size;
+  return true;
+}
+
+String &String::concat(const char *data, unsigned int count)
+{
+  if (!reserve(len_ + count))
+    return *this;
+  memmove(buffer() + len_, data, count);
+  len_ += count;
+  buffer()[len_] = '\0';
+  return *this;
+}
+
+void String::assign(const char *data, unsigned int count)
+{
+  if (!reserve(count))
+    return;
+  memmove(buffer(), data, count);
+  len_ = count;
+  buffer()[len_] = '\0';
+}
+
+void String::release()
+{
+  if (!isSSO())
+    hostheap::counted_free(ptr_);
+  ptr_ = nullptr;
+  cap_ = SSO_SIZE;
+  len_ = 0;
+  sso_[0] = '\0';
+}
@@ -0,0 +1,86 @@
+#include "WiFi.h"
+
+#include <string.h>
+
+#include "HostSim.h"
+
+WiFiClass WiFi;
+
+wl_status_t WiFiClass::begin(const char *, const char *, int32_t channel, const uint8_t *bssid, bool connect)
+{
+  if (!connect)
+    return WL_DISCONNECTED;
+  bool fast = channel == hostsim::wifiChannel() && bssid && memcmp(bssid, hostsim::wifiBssid(), 6) == 0;
+  bool wrongChannel = channel != 0 && !fast;
+  started_ = true;
+  lost_ = false;
+  const hostsim::CostModel &cost = hostsim::costs();
+  // a stale channel/BSSID never associates; the caller has to fall back to a scan
+  uint32_t associateMs = fast ? cost.wifiFastAssociateMs : cost.wifiAssociateMs;
+  if (staticIp_ != 0)
+    associateMs -= cost.wifiDhcpMs;
+  associatedAtUs_ = wrongChannel ? UINT64_MAX : hostsim::nowMicros() + (uint64_t)associateMs * 1000;
+  return WL_DISCONNECTED;
+}
+
+bool WiFiClass::disconnect(bool)
+{
+  started_ = false;
+  return true;
+}
+
+wl_status_t WiFiClass::status()
+{
+  if (!started_)
+    return WL_IDLE_STATUS;
+  if (!hostsim::wifiAvailable())
+  {
+    lost_ = true;
+    return WL_CONNECTION_LOST;
+  }
+  if (lost_)
+  {
+    if (!autoReconnect_)
+      return WL_CONNECTION_LOST;
+    // the driver re-associates on its own, with a full scan
+    lost_ = false;
+    associatedAtUs_ = hostsim::nowMicros() + (uint64_t)hostsim::costs().wifiAssociateMs * 1000;
+  }
+  return hostsim::nowMicros() >= associatedAtUs_ ? WL_CONNECTED : WL_DISCONNECTED;
+}
+
+bool WiFiClass::config(IPAddress local, IPAddress, IPAddress, IPAddress, IPAddress)
+{
+  staticIp_ = local;
+  return true;
+}
+
+IPAddress WiFiClass::localIP()
+{
+  if (status() != WL_CONNECTED)
+    return IPAddress();
+  return staticIp_ != 0 ? staticIp_ : IPAddress(192, 168, 0, 42);
+}
+
+IPAddress WiFiClass::gatewayIP() { return status() == WL_CONNECTED ? IPAddress(192, 168, 0, 1) : IPAddress(); }
+IPAddress WiFiClass::subnetMask() { return status() == WL_CONNECTED ? IPAddress(255, 255, 255, 0) : IPAddress(); }
+IPAddress WiFiClass::dnsIP(uint8_t) { return status() == WL_CONNECTED ? IPAddress(192, 168, 0, 1) : IPAddress(); }
+
+uint8_t *WiFiClass::macAddress(uint8_t *mac)
+{
+  static const uint8_t stationMac[6] = {0x24, 0x6f, 0x28, 0x9a, 0x3c, 0x51};
+  memcpy(mac, stationMac, 6);
+  return mac;
+}
+
+uint8_t *WiFiClass::BSSID()
+{
+  if (status() != WL_CONNECTED)
+    return nullptr;
+  memcpy(bssid_, hostsim::wifiBssid(), 6);
+  return bssid_;
+}
+
+int32_t WiFiClass::channel() { return status() == WL_CONNECTED ? hostsim::wifiChannel() : 0; }
+
+bool WiFiClient::connected() const { return hostsim::brokerAvailable(); }
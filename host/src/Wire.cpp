@@ -0,0 +1,70 @@
+#include "Wire.h"
+
+#include <string.h>
+
+#include "HostSim.h"
+#include "SimDevices.h"
+
+TwoWire Wire;
+
+bool TwoWire::begin(int, int, uint32_t frequency)
+{
+  if (frequency)
+    clock_ = frequency;
+  return true;
+}
+
+bool TwoWire::setClock(uint32_t frequency)
+{
+  clock_ = frequency;
+  return true;
+}
+
+void TwoWire::beginTransmission(uint16_t address)
+{
+  txAddress_ = address;
+  txLength_ = 0;
+}
+
+size_t TwoWire::write(uint8_t data)
+{
+  if (txLength_ >= BUFFER_LENGTH)
+    return 0;
+  txBuffer_[txLength_++] = data;
+  return 1;
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t quantity)
+{
+  size_t n = 0;
+  while (n < quantity && write(data[n]))
+    n++;
+  return n;
+}
+
+uint8_t TwoWire::endTransmission(bool)
+{
+  hostsim::detail::chargeI2c(txLength_, clock_);
+  bool acked = hostsim::detail::i2cWrite(txAddress_, txBuffer_, txLength_);
+  txLength_ = 0;
+  return acked ? 0 : 2; // 2 = NACK on address, as in the Arduino API
+}
+
+size_t TwoWire::requestFrom(uint16_t address, size_t size, bool)
+{
+  if (size > BUFFER_LENGTH)
+    size = BUFFER_LENGTH;
+  hostsim::detail::chargeI2c(size, clock_);
+  rxIndex_ = 0;
+  rxLength_ = hostsim::detail::i2cRead(address, rxBuffer_, size);
+  return rxLength_;
+}
+
+int TwoWire::available() { return (int)(rxLength_ - rxIndex_); }
+
+int TwoWire::read()
+{
+  if (rxIndex_ >= rxLength_)
+    return -1;
+  return rxBuffer_[rxIndex_++];
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+// Alert configuration, sampling periods and report-by-exception settings of
+// the telemetry frame. Shared by the firmware and the fleet load generator
+// (bench/fleet), so simulated devices sample and publish exactly when a board
+// would.
+
+#include <math.h>
+#include <stddef.h>
+
+#include <AdaptivePeriod.h>
+#include <AnomalyDetector.h>
+#include <ReportPolicy.h>
+#include <TelemetryFrame.h>
+
+// Alerts: absolute climate limits plus one streaming anomaly detector per
+// channel (AnomalyDetector.h). The detectors take temperature and humidity
+// in 0.01 C / 0.01 %RH, and motion as the window's peak dynamic |a| (gravity
+// removed) in raw counts. The firmware starts from these defaults, then
+// from the copy it keeps in NVS, and takes changes from config/alerts.
+struct AlertConfig
+{
+  float tempMin; // C
+  float tempMax; // C
+  float humMax;  // %RH
+  AnomalyPolicy temp;
+  AnomalyPolicy hum;
+  AnomalyPolicy motion;
+};
+
+inline bool operator==(const AlertConfig &a, const AlertConfig &b)
+{
+  return a.tempMin == b.tempMin && a.tempMax == b.tempMax && a.humMax == b.humMax && a.temp == b.temp &&
+         a.hum == b.hum && a.motion == b.motion;
+}
+inline bool operator!=(const AlertConfig &a, const AlertConfig &b) { return !(a == b); }
+
+const float COUNTS_PER_MG = 16.384f; // accelerometer at +-2 g
+
+const AlertConfig DEFAULT_ALERT_CONFIG = {
+    10.0f,
+    25.0f,
+    80.0f,
+    {30, 40, 30, 6, false},  // 4 sigma off the last ~64 readings, sigma at least 0.3 C
+    {200, 40, 30, 6, false}, // sigma at least 2 %RH
+    {350, 60, 40, 5, true},  // 6 sigma above the last ~32 windows, sigma at least ~21 mg
+};
+
+// Adaptive sampling: the climate (DHT11) and motion periods each snap to
+// their minimum as soon as their signal is active and double after a few
+// quiet samples, up to their maximum. ADAPTIVE_SAMPLING=0 samples both every
+// 5 s as before.
+#ifndef ADAPTIVE_SAMPLING
+#define ADAPTIVE_SAMPLING 1
+#endif
+#ifndef CLIMATE_PERIOD_MIN_MS
+#define CLIMATE_PERIOD_MIN_MS 2000
+#endif
+#ifndef CLIMATE_PERIOD_MAX_MS
+#define CLIMATE_PERIOD_MAX_MS 60000
+#endif
+#ifndef MOTION_PERIOD_MIN_MS
+#define MOTION_PERIOD_MIN_MS 1000
+#endif
+#ifndef MOTION_PERIOD_MAX_MS
+#define MOTION_PERIOD_MAX_MS 30000
+#endif
+
+#if ADAPTIVE_SAMPLING
+constexpr SamplingPolicy CLIMATE_SAMPLING = {CLIMATE_PERIOD_MIN_MS, CLIMATE_PERIOD_MAX_MS, 0.5f, 3};
+constexpr SamplingPolicy MOTION_SAMPLING = {MOTION_PERIOD_MIN_MS, MOTION_PERIOD_MAX_MS, 0.5f, 3};
+#else
+constexpr SamplingPolicy CLIMATE_SAMPLING = {5000, 5000, 0.5f, 3};
+constexpr SamplingPolicy MOTION_SAMPLING = {5000, 5000, 0.5f, 3};
+#endif
+static_assert(CLIMATE_SAMPLING.minMs <= CLIMATE_SAMPLING.maxMs && MOTION_SAMPLING.minMs <= MOTION_SAMPLING.maxMs,
+              "sampling period bounds are reversed");
+
+// Activity scores of 1.0: what counts as "something is happening".
+const float MOTION_ACTIVE_EXCESS = 2000.0f; // window peak |a| above its RMS, raw counts (~0.12 g)
+const float TEMP_ACTIVE_RATE = 0.5f;        // C per minute
+const float HUM_ACTIVE_RATE = 3.0f;         // %RH per minute
+// Rates are taken over at least a minute, so one DHT11 quantisation step
+// between two close samples does not look like an event.
+const uint32_t RATE_MIN_SPAN_MS = 60000;
+
+// A motion interrupt closes the window at once, but a vibrating board can
+// fire several a second: the next one waits this long after a window closed.
+const uint32_t MOTION_EVENT_GAP_MS = 100;
+
+// Replay of the frames journaled while offline, after reconnecting.
+const size_t REPLAY_BATCH_FRAMES = 12;        // fits the 512-byte MQTT buffer
+const uint32_t REPLAY_INTERVAL_MS = 250;      // at most 48 replayed frames/s
+const uint32_t REPLAY_START_JITTER_MS = 2000; // spread a fleet's replays after an outage
+
+// A limit alert clears only once the value is back inside by the hysteresis
+// margin, so readings on the boundary don't flap.
+const float TEMP_HYSTERESIS = 0.5;
+const float HUM_HYSTERESIS = 2.0;
+
+// Report-by-exception: {absolute deadband, relative deadband, heartbeat ms}.
+// Alert channels publish on every state change.
+const ReportPolicy TEMP_REPORT = {0.5f, 0.0f, 60000};
+const ReportPolicy HUM_REPORT = {2.0f, 0.0f, 60000};
+const ReportPolicy MOTION_REPORT = {1000.0f, 0.05f, 60000}; // peak |a|, raw counts
+const ReportPolicy ALERT_REPORT = {0.5f, 0.0f, 60000};
+
+inline bool dhtValid(const TelemetrySample &sample) { return sample.flags & FRAME_DHT_VALID; }
+inline bool motionAlertOf(const TelemetrySample &sample) { return sample.flags & FRAME_MOTION_ALERT; }
+inline bool climateAlertOf(const TelemetrySample &sample) { return sample.flags & FRAME_CLIMATE_ALERT; }
+
+// Peak |a| of the sample's window as the motion channel value; NaN if no samples.
+inline float motionLevel(const TelemetrySample &sample)
+{
+  return (sample.flags & FRAME_MPU_VALID) ? (float)sample.accelPeakMagnitude : NAN;
+}
+
+struct ReportChannels
+{
+  ReportChannel temp{TEMP_REPORT};
+  ReportChannel hum{HUM_REPORT};
+  ReportChannel motion{MOTION_REPORT};
+  ReportChannel motionAlert{ALERT_REPORT};
+  ReportChannel climateAlert{ALERT_REPORT};
+
+  // The frame carries every channel, so it goes out when any one of them is due.
+  bool frameDue(const TelemetrySample &sample, uint32_t nowMs) const
+  {
+    return temp.due(sample.temperature, nowMs) || hum.due(sample.humidity, nowMs) ||
+           motion.due(motionLevel(sample), nowMs) || motionAlert.due(motionAlertOf(sample), nowMs) ||
+           climateAlert.due(climateAlertOf(sample), nowMs);
+  }
+
+  // Restarts every channel's deadband and heartbeat from this frame.
+  void framePublished(const TelemetrySample &sample, uint32_t nowMs)
+  {
+    temp.published(sample.temperature, nowMs);
+    hum.published(sample.humidity, nowMs);
+    motion.published(motionLevel(sample), nowMs);
+    motionAlert.published(motionAlertOf(sample), nowMs);
+    climateAlert.published(climateAlertOf(sample), nowMs);
+  }
+};
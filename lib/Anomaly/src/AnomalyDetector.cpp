@@ -0,0 +1,56 @@
+#include "AnomalyDetector.h"
+
+#include <MotionFeatures.h> // isqrt64
+
+void AnomalyChannel::reset()
+{
+  state_ = AnomalyState();
+}
+
+bool AnomalyChannel::update(int32_t value)
+{
+  AnomalyState &s = state_;
+  if (s.count == 0)
+  {
+    if (!policy_.upperOnly)
+    {
+      s.meanQ8 = value * 256;
+      s.count = 1;
+      return s.active;
+    }
+    s.meanQ8 = 0; // prior: one value at rest
+    s.count = 1;
+  }
+
+  // Squares in units^2 from Q8 deviations: (d8 / 256)^2 = d8^2 >> 16.
+  int32_t d8 = value * 256 - s.meanQ8;
+  uint64_t dSq = (uint64_t)((int64_t)d8 * d8) >> 16;
+  uint64_t floorSq = (uint64_t)((int64_t)policy_.minStd * policy_.minStd);
+  uint64_t stdSq = s.variance > floorSq ? s.variance : floorSq;
+
+  // z > zEnter  <=>  d^2 * 100 > zEnterX10^2 * std^2
+  uint64_t enterSq = (uint64_t)policy_.zEnterX10 * policy_.zEnterX10 * stdSq;
+  uint64_t exitSq = (uint64_t)policy_.zExitX10 * policy_.zExitX10 * stdSq;
+  bool counts = !policy_.upperOnly || d8 > 0;
+  if (counts && dSq * 100 > enterSq)
+    s.active = true;
+  else if (!counts || dSq * 100 < exitSq)
+    s.active = false;
+
+  if (dSq * 100 > enterSq)
+  {
+    dSq = enterSq / 100;
+    int32_t limit8 = (int32_t)isqrt64(dSq) * 256;
+    d8 = d8 > 0 ? limit8 : -limit8;
+  }
+
+  uint32_t warm = 1u << policy_.shift;
+  if (s.count < warm)
+    s.count++;
+  s.meanQ8 += d8 / (int32_t)s.count;
+  // population variance: var' = (1 - 1/n) * (var + d^2 / n)
+  uint64_t variance = s.variance + dSq / s.count;
+  variance -= variance / s.count;
+  s.variance = variance > UINT32_MAX ? UINT32_MAX : (uint32_t)variance;
+  return s.active;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+// Streaming anomaly detection for one signal, in integer arithmetic: O(1)
+// state per channel and a few dozen instructions per value.
+//
+// AnomalyChannel keeps a running mean (Q8 fixed point) and variance of the
+// signal. The first 2^shift values use Welford's update (weight 1/n), so the
+// estimate is exact from the second value on; after that the weight stays at
+// 2^-shift, an exponentially weighted mean and variance that follow slow
+// drift with a memory of about 2^shift values.
+//
+// The statistics are plain data (AnomalyState) owned by the caller, so they
+// can be kept in RTC memory across deep sleep; all zero means no history.
+//
+// Each value is scored against the statistics before it is folded in: the
+// alert enters when it lies more than zEnter standard deviations from the
+// mean and clears below zExit. The deviation is floored at minStd, so a
+// perfectly steady signal does not alert on its first quantisation step. An
+// outlier is folded in clamped to zEnter deviations: one spike cannot
+// inflate the variance and mask the next, while a lasting change of level is
+// still learned. An upper-only channel is a magnitude resting near 0: with
+// no history its first value is scored against 0 and the deviation floor. A
+// two-sided channel has no reference yet, so its first value only seeds the
+// mean.
+//
+// Values are in the caller's fixed-point units (0.01 C, raw counts, ...) and
+// must stay within +-2^21; z thresholds go up to 100 (zEnterX10 <= 1000).
+
+#include <stdint.h>
+
+struct AnomalyPolicy
+{
+  int32_t minStd;     // deviation floor, in the channel's units
+  uint16_t zEnterX10; // alert beyond zEnterX10 / 10 standard deviations
+  uint16_t zExitX10;  // clear within zExitX10 / 10
+  uint8_t shift;      // EWMA weight 2^-shift once warmed up
+  bool upperOnly;     // only values above the mean are anomalous
+};
+
+inline bool operator==(const AnomalyPolicy &a, const AnomalyPolicy &b)
+{
+  return a.minStd == b.minStd && a.zEnterX10 == b.zEnterX10 && a.zExitX10 == b.zExitX10 && a.shift == b.shift &&
+         a.upperOnly == b.upperOnly;
+}
+inline bool operator!=(const AnomalyPolicy &a, const AnomalyPolicy &b) { return !(a == b); }
+
+struct AnomalyState
+{
+  int32_t meanQ8;
+  uint32_t variance; // units^2
+  uint32_t count;    // saturates at 2^shift
+  bool active;
+};
+
+class AnomalyChannel
+{
+public:
+  AnomalyChannel(const AnomalyPolicy &policy, AnomalyState &state) : policy_(policy), state_(state) {}
+
+  // Scores value, folds it into the statistics and returns the alert state.
+  bool update(int32_t value);
+
+  bool active() const { return state_.active; }
+  int32_t mean() const { return state_.meanQ8 / 256; }
+  uint32_t variance() const { return state_.variance; }
+
+  // Takes effect from the next value; the statistics are kept.
+  void setPolicy(const AnomalyPolicy &policy) { policy_ = policy; }
+  const AnomalyPolicy &policy() const { return policy_; }
+
+  // Forgets the statistics and clears the alert.
+  void reset();
+
+private:
+  AnomalyPolicy policy_;
+  AnomalyState &state_;
+};
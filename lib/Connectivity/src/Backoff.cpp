@@ -0,0 +1,12 @@
+#include "Backoff.h"
+
+uint32_t backoffDelayMs(uint8_t attempt, uint32_t baseMs, uint32_t maxMs, uint32_t entropy)
+{
+  uint32_t delayMs = baseMs;
+  for (uint8_t i = 0; i < attempt && delayMs < maxMs; i++)
+    delayMs *= 2;
+  if (delayMs > maxMs)
+    delayMs = maxMs;
+  uint32_t half = delayMs / 2;
+  return half + (half ? entropy % (half + 1) : 0);
+}
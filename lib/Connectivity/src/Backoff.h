@@ -0,0 +1,17 @@
+#pragma once
+
+// Retry pacing shared by ConnectionManager and the fleet load generator
+// (bench/fleet), which has no Wi-Fi stack: nothing in here touches the
+// network.
+
+#include <stdint.h>
+
+const uint32_t WIFI_BACKOFF_BASE_MS = 1000;
+const uint32_t WIFI_BACKOFF_MAX_MS = 60000;
+const uint32_t MQTT_BACKOFF_BASE_MS = 500;
+const uint32_t MQTT_BACKOFF_MAX_MS = 30000;
+
+// Equal-jitter exponential backoff: the delay for `attempt` (0-based) is
+// min(maxMs, baseMs * 2^attempt), of which the upper half is randomised by
+// `entropy`.
+uint32_t backoffDelayMs(uint8_t attempt, uint32_t baseMs, uint32_t maxMs, uint32_t entropy);
@@ -0,0 +1,173 @@
+#include "ConnectionManager.h"
+
+#include <Log.h>
+#include <PubSubClient.h>
+#include <WiFi.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace
+{
+  const uint32_t WIFI_TIMEOUT_MS = 15000;     // full scan + auth + DHCP
+  const uint32_t WIFI_FAST_TIMEOUT_MS = 3000; // cached channel/BSSID
+  const uint16_t MQTT_SOCKET_TIMEOUT_S = 2; // TCP connect and CONNACK each
+  const uint8_t WIFI_FAST_ATTEMPTS = 2;     // then fall back to a full scan
+  const uint8_t LEASE_REUSE_LIMIT = 16;     // then DHCP again
+}
+
+ConnectionManager::ConnectionManager(WiFiClient &net, PubSubClient &mqtt, const char *ssid, const char *password)
+    : net_(net), mqtt_(mqtt), ssid_(ssid), password_(password)
+{
+  clientId_[0] = '\0';
+}
+
+void ConnectionManager::begin()
+{
+  uint8_t mac[6];
+  WiFi.macAddress(mac);
+  snprintf(clientId_, sizeof(clientId_), "ESP32Client-%02x%02x%02x", mac[3], mac[4], mac[5]);
+
+  WiFi.mode(WIFI_STA);
+  WiFi.setAutoReconnect(false); // retries are paced by the backoff below
+  net_.setTimeout(MQTT_SOCKET_TIMEOUT_S); // seconds in arduino-esp32 2.x; the default is 3 s
+  mqtt_.setSocketTimeout(MQTT_SOCKET_TIMEOUT_S);
+  everConnected_ = false;
+  startAssociation(millis());
+}
+
+void ConnectionManager::startAssociation(unsigned long now)
+{
+  fastAttempt_ = cache_.channel != 0 && wifiAttempts_ < WIFI_FAST_ATTEMPTS;
+  bool useStaticIp = fastAttempt_ && cache_.ip != 0 && cache_.leaseReuses < LEASE_REUSE_LIMIT;
+  if (useStaticIp)
+    cache_.leaseReuses++;
+  LOG_INFO("Connecting to Wi-Fi%s...\n", fastAttempt_ ? " (cached channel)" : "");
+  WiFi.disconnect();
+  if (useStaticIp)
+    WiFi.config(IPAddress(cache_.ip), IPAddress(cache_.gateway), IPAddress(cache_.subnet), IPAddress(cache_.dns));
+  else if (staticIp_)
+    WiFi.config(IPAddress(), IPAddress(), IPAddress()); // back to DHCP
+  staticIp_ = useStaticIp;
+  if (fastAttempt_)
+    WiFi.begin(ssid_, password_, cache_.channel, cache_.bssid);
+  else
+    WiFi.begin(ssid_, password_);
+  state_ = WIFI_ASSOCIATING;
+  stateSince_ = now;
+}
+
+void ConnectionManager::scheduleWifiRetry(unsigned long now)
+{
+  nextAttempt_ = now + backoffDelayMs(wifiAttempts_, WIFI_BACKOFF_BASE_MS, WIFI_BACKOFF_MAX_MS, (uint32_t)random(0x7fffffff));
+  if (wifiAttempts_ < 31)
+    wifiAttempts_++;
+  state_ = WIFI_BACKOFF;
+  stateSince_ = now;
+}
+
+void ConnectionManager::scheduleMqttRetry(unsigned long now)
+{
+  nextAttempt_ = now + backoffDelayMs(mqttAttempts_, MQTT_BACKOFF_BASE_MS, MQTT_BACKOFF_MAX_MS, (uint32_t)random(0x7fffffff));
+  if (mqttAttempts_ < 31)
+    mqttAttempts_++;
+  state_ = MQTT_BACKOFF;
+  stateSince_ = now;
+}
+
+void ConnectionManager::connectMqtt(unsigned long now)
+{
+  LOG_INFO("Connecting to MQTT...");
+  if (mqtt_.connect(clientId_))
+  {
+    LOG_INFO("connected\n");
+    state_ = CONNECTED;
+    stateSince_ = now;
+    mqttAttempts_ = 0;
+    if (everConnected_)
+      reconnects_++;
+    everConnected_ = true;
+    if (onConnect_)
+      onConnect_();
+  }
+  else if (staticIp_)
+  {
+    // the cached address may be stale: associate again with DHCP
+    LOG_INFO("failed, rc=%d; dropping cached lease\n", mqtt_.state());
+    cache_.ip = 0;
+    scheduleWifiRetry(millis());
+  }
+  else
+  {
+    LOG_INFO("failed, rc=%d\n", mqtt_.state());
+    scheduleMqttRetry(millis());
+  }
+}
+
+void ConnectionManager::loop()
+{
+  unsigned long now = millis();
+  bool wifiUp = WiFi.status() == WL_CONNECTED;
+
+  switch (state_)
+  {
+  case WIFI_IDLE:
+    startAssociation(now);
+    break;
+
+  case WIFI_ASSOCIATING:
+    if (wifiUp)
+    {
+      IPAddress ip = WiFi.localIP();
+      LOG_INFO("Wi-Fi connected. ESP32 IP address: %u.%u.%u.%u\n", ip[0], ip[1], ip[2], ip[3]);
+      const uint8_t *bssid = WiFi.BSSID();
+      if (bssid)
+      {
+        memcpy(cache_.bssid, bssid, sizeof(cache_.bssid));
+        cache_.channel = WiFi.channel();
+        if (!staticIp_)
+        {
+          cache_.ip = ip;
+          cache_.gateway = WiFi.gatewayIP();
+          cache_.subnet = WiFi.subnetMask();
+          cache_.dns = WiFi.dnsIP();
+          cache_.leaseReuses = 0;
+        }
+      }
+      wifiAttempts_ = 0;
+      connectMqtt(now);
+    }
+    else if (now - stateSince_ >= (fastAttempt_ ? WIFI_FAST_TIMEOUT_MS : WIFI_TIMEOUT_MS))
+    {
+      LOG_WARN("Wi-Fi connection timed out\n");
+      scheduleWifiRetry(now);
+    }
+    break;
+
+  case WIFI_BACKOFF:
+    if ((long)(now - nextAttempt_) >= 0)
+      startAssociation(now);
+    break;
+
+  case MQTT_BACKOFF:
+    if (!wifiUp)
+      scheduleWifiRetry(now);
+    else if ((long)(now - nextAttempt_) >= 0)
+      connectMqtt(now);
+    break;
+
+  case CONNECTED:
+    if (!wifiUp)
+    {
+      LOG_WARN("Wi-Fi connection lost\n");
+      mqtt_.disconnect();
+      // first retry uses the cached channel right away
+      startAssociation(now);
+    }
+    else if (!mqtt_.connected())
+    {
+      LOG_WARN("MQTT connection lost\n");
+      scheduleMqttRetry(now);
+    }
+    break;
+  }
+}
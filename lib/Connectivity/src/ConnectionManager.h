@@ -0,0 +1,97 @@
+#pragma once
+
+// Non-blocking Wi-Fi + MQTT connection state machine, stepped from loop().
+//
+// Nothing in here waits: association is polled, and a failed Wi-Fi or broker
+// attempt schedules the next one with exponential backoff and jitter, so
+// sampling and local alerting keep running while the network is down. The
+// only blocking call left is PubSubClient::connect() itself: the TCP
+// handshake, bounded by the WiFiClient's connect timeout, then the CONNACK,
+// bounded by PubSubClient's socket timeout. Both are set to 2 s.
+//
+// After the first association the channel, BSSID and DHCP lease are cached
+// and reused, which skips the scan and DHCP on reconnect; if the access point
+// moved, the next attempt falls back to a full scan with DHCP. The lease is
+// reused for at most LEASE_REUSE_LIMIT associations before DHCP runs again,
+// and dropped as soon as the broker can't be reached over it (the address
+// may have been handed to another station). The cache is a plain struct so
+// it can be kept in RTC memory across deep sleep.
+
+#include <stdint.h>
+
+#include "Backoff.h"
+
+class PubSubClient;
+class WiFiClient;
+
+struct ConnectionCache
+{
+  int32_t channel; // 0 = nothing cached
+  uint8_t bssid[6];
+  uint32_t ip; // last lease, reused as a static address; 0 = use DHCP
+  uint32_t gateway;
+  uint32_t subnet;
+  uint32_t dns;
+  uint8_t leaseReuses; // associations on the cached lease since DHCP
+};
+
+class ConnectionManager
+{
+public:
+  enum State
+  {
+    WIFI_IDLE,
+    WIFI_ASSOCIATING,
+    WIFI_BACKOFF,
+    MQTT_BACKOFF,
+    CONNECTED
+  };
+
+  // net is the client mqtt runs over; its connect timeout is set in begin().
+  ConnectionManager(WiFiClient &net, PubSubClient &mqtt, const char *ssid, const char *password);
+
+  // Builds the client ID from the station MAC and starts associating.
+  void begin();
+
+  // Seeds the fast-reconnect target, e.g. from RTC memory after a deep
+  // sleep. Call before begin().
+  void restoreCache(const ConnectionCache &cache) { cache_ = cache; }
+  const ConnectionCache &cache() const { return cache_; }
+
+  // Advances the state machine; call once per loop().
+  void loop();
+
+  // Called after every successful broker connect (subscriptions go here).
+  void onConnect(void (*callback)()) { onConnect_ = callback; }
+
+  bool connected() const { return state_ == CONNECTED; }
+  State state() const { return state_; }
+  const char *clientId() const { return clientId_; }
+  // Broker connects after the first one of this boot.
+  uint32_t reconnects() const { return reconnects_; }
+
+private:
+  void startAssociation(unsigned long now);
+  void scheduleWifiRetry(unsigned long now);
+  void scheduleMqttRetry(unsigned long now);
+  void connectMqtt(unsigned long now);
+
+  WiFiClient &net_;
+  PubSubClient &mqtt_;
+  const char *ssid_;
+  const char *password_;
+  void (*onConnect_)() = nullptr;
+
+  State state_ = WIFI_IDLE;
+  char clientId_[24];
+  unsigned long stateSince_ = 0;
+  unsigned long nextAttempt_ = 0;
+  uint8_t wifiAttempts_ = 0;
+  uint8_t mqttAttempts_ = 0;
+  uint32_t reconnects_ = 0;
+  bool everConnected_ = false;
+
+  bool fastAttempt_ = false;
+  bool staticIp_ = false;
+  ConnectionCache cache_ = {};
+};
@@ -0,0 +1,149 @@
+#include "Dht11Reader.h"
+
+#include <Arduino.h>
+#include <esp_attr.h>
+#include <math.h>
+
+namespace
+{
+  const unsigned long START_PULSE_MS = 20;       // datasheet: at least 18 ms
+  const unsigned long CAPTURE_TIMEOUT_US = 6000; // a full answer takes ~5.1 ms
+
+  // Falling-to-falling periods, with margin for interrupt latency.
+  const uint32_t RESPONSE_MIN_US = 120; // 80 low + 80 high
+  const uint32_t RESPONSE_MAX_US = 220;
+  const uint32_t BIT_MIN_US = 60;  // 50 low + 26 high
+  const uint32_t BIT_MAX_US = 160; // 50 low + 70 high
+  const uint32_t BIT_ONE_US = 100;
+}
+
+Dht11Reader *Dht11Reader::capturing_ = nullptr;
+
+Dht11Status decodeDht11(const uint32_t *edgesUs, size_t count, Dht11Reading &out)
+{
+  if (count < DHT11_FRAME_EDGES)
+    return DHT11_TIMEOUT;
+  uint32_t response = edgesUs[1] - edgesUs[0];
+  if (response < RESPONSE_MIN_US || response > RESPONSE_MAX_US)
+    return DHT11_BAD_PULSE;
+
+  uint8_t data[5] = {};
+  for (size_t bit = 0; bit < 40; bit++)
+  {
+    uint32_t period = edgesUs[bit + 2] - edgesUs[bit + 1];
+    if (period < BIT_MIN_US || period > BIT_MAX_US)
+      return DHT11_BAD_PULSE;
+    data[bit / 8] = (uint8_t)(data[bit / 8] << 1 | (period > BIT_ONE_US ? 1 : 0));
+  }
+  if ((uint8_t)(data[0] + data[1] + data[2] + data[3]) != data[4])
+    return DHT11_CHECKSUM;
+
+  // same conversion as the Adafruit driver for DHT11
+  out.humidity = data[0] + data[1] * 0.1f;
+  float temperature = data[2];
+  if (data[3] & 0x80)
+    temperature = -1 - temperature;
+  out.temperature = temperature + (data[3] & 0x0f) * 0.1f;
+  return DHT11_OK;
+}
+
+const char *dht11StatusName(Dht11Status status)
+{
+  switch (status)
+  {
+  case DHT11_OK:
+    return "ok";
+  case DHT11_TIMEOUT:
+    return "timeout";
+  case DHT11_BAD_PULSE:
+    return "bad pulse";
+  case DHT11_CHECKSUM:
+    return "checksum";
+  }
+  return "?";
+}
+
+void Dht11Reader::begin()
+{
+  pinMode(pin_, INPUT_PULLUP);
+  state_ = IDLE;
+  started_ = false;
+}
+
+bool Dht11Reader::start()
+{
+  unsigned long now = millis();
+  if (state_ != IDLE || (started_ && now - startMs_ < DHT11_MIN_INTERVAL_MS))
+    return false;
+  pinMode(pin_, OUTPUT);
+  digitalWrite(pin_, LOW);
+  started_ = true;
+  startMs_ = now;
+  state_ = START_PULSE;
+  return true;
+}
+
+bool Dht11Reader::poll()
+{
+  switch (state_)
+  {
+  case IDLE:
+    return false;
+
+  case START_PULSE:
+    if (millis() - startMs_ < START_PULSE_MS)
+      return false;
+    // armed before the release so the response edge is not missed; the
+    // release itself is a rising edge
+    edgeCount_ = 0;
+    capturing_ = this;
+    attachInterrupt(digitalPinToInterrupt(pin_), onFallingEdge, FALLING);
+    pinMode(pin_, INPUT_PULLUP);
+    captureStartUs_ = micros();
+    state_ = CAPTURING;
+    return false;
+
+  case CAPTURING:
+  {
+    unsigned long elapsed = micros() - captureStartUs_;
+    if (edgeCount_ < DHT11_FRAME_EDGES && elapsed < CAPTURE_TIMEOUT_US)
+      return false;
+    finish();
+    return true;
+  }
+  }
+  return false;
+}
+
+void Dht11Reader::finish()
+{
+  detachInterrupt(digitalPinToInterrupt(pin_));
+  capturing_ = nullptr;
+  state_ = IDLE;
+
+  status_ = decodeDht11(edgesUs_, edgeCount_, reading_);
+  results_++;
+  if (status_ == DHT11_TIMEOUT)
+    timeouts_++;
+  else if (status_ == DHT11_BAD_PULSE)
+    badPulses_++;
+  else if (status_ == DHT11_CHECKSUM)
+    checksumErrors_++;
+}
+
+float Dht11Reader::temperature() const { return status_ == DHT11_OK ? reading_.temperature : NAN; }
+
+float Dht11Reader::humidity() const { return status_ == DHT11_OK ? reading_.humidity : NAN; }
+
+void IRAM_ATTR Dht11Reader::onFallingEdge()
+{
+  Dht11Reader *reader = capturing_;
+  if (!reader)
+    return;
+  uint8_t count = reader->edgeCount_;
+  if (count < DHT11_MAX_EDGES)
+  {
+    reader->edgesUs_[count] = micros();
+    reader->edgeCount_ = count + 1;
+  }
+}
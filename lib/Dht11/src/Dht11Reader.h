@@ -0,0 +1,99 @@
+#pragma once
+
+// Non-blocking DHT11 reader. The Adafruit driver bit-bangs the single-wire
+// protocol with interrupts off for the whole ~23 ms transaction; here the
+// start pulse is timed by the caller's loop and the sensor's answer is
+// captured by a GPIO interrupt that only timestamps falling edges. The frame
+// is decoded afterwards from those timestamps, and one transaction gives both
+// temperature and humidity.
+//
+// Timing of the sensor's answer (after the 18 ms start pulse is released):
+// 80 us low + 80 us high, then per bit 50 us low + 26-28 us high for a 0 or
+// 70 us high for a 1, then 50 us low. The falling edges are the response,
+// the start of each bit and the end of the frame; the falling-to-falling
+// period of a bit is ~77 us for a 0 and ~120 us for a 1.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define DHT11_FRAME_EDGES 42 // response + 40 bit starts + end of frame
+#define DHT11_MAX_EDGES 48   // room for a few glitches before the buffer stops
+#define DHT11_MIN_INTERVAL_MS 1000 // the sensor needs 1 s between transactions
+
+enum Dht11Status : uint8_t
+{
+  DHT11_OK,
+  DHT11_TIMEOUT,   // the sensor did not answer, or stopped mid-frame
+  DHT11_BAD_PULSE, // an edge period outside the protocol (noise on the line)
+  DHT11_CHECKSUM
+};
+
+struct Dht11Reading
+{
+  float temperature; // C, 0.1 resolution
+  float humidity;    // %RH, whole percent
+};
+
+// Decodes one transaction from its falling-edge timestamps (us, any epoch).
+// Edges past DHT11_FRAME_EDGES are ignored.
+Dht11Status decodeDht11(const uint32_t *edgesUs, size_t count, Dht11Reading &out);
+
+const char *dht11StatusName(Dht11Status status);
+
+class Dht11Reader
+{
+public:
+  explicit Dht11Reader(uint8_t pin) : pin_(pin) {}
+
+  void begin();
+
+  // Pulls the line low to start a transaction. Returns false while one is
+  // running or within DHT11_MIN_INTERVAL_MS of the last start.
+  bool start();
+
+  // Advances a running transaction; never waits. Call every few ms: the
+  // start pulse lasts 20 ms and the answer ~5 ms. Returns true once when a
+  // transaction has finished.
+  bool poll();
+
+  bool busy() const { return state_ != IDLE; }
+  Dht11Status status() const { return status_; }
+  // From the last transaction; NaN if it failed.
+  float temperature() const;
+  float humidity() const;
+  // Finished transactions so far, failed ones included. A caller that keeps
+  // the count it last read from can tell a new result from one it has used.
+  uint32_t results() const { return results_; }
+
+  uint32_t timeouts() const { return timeouts_; }
+  uint32_t badPulses() const { return badPulses_; }
+  uint32_t checksumErrors() const { return checksumErrors_; }
+
+private:
+  enum State : uint8_t
+  {
+    IDLE,
+    START_PULSE,
+    CAPTURING
+  };
+
+  static void onFallingEdge();
+  void finish();
+
+  uint8_t pin_;
+  State state_ = IDLE;
+  bool started_ = false;
+  unsigned long startMs_ = 0;
+  unsigned long captureStartUs_ = 0;
+  Dht11Status status_ = DHT11_TIMEOUT;
+  Dht11Reading reading_ = {};
+  uint32_t results_ = 0;
+  uint32_t timeouts_ = 0;
+  uint32_t badPulses_ = 0;
+  uint32_t checksumErrors_ = 0;
+
+  // written by the ISR while CAPTURING, read once it is detached
+  uint32_t edgesUs_[DHT11_MAX_EDGES];
+  volatile uint8_t edgeCount_ = 0;
+  static Dht11Reader *capturing_;
+};
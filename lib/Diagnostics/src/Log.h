@@ -0,0 +1,32 @@
+#pragma once
+
+// Compile-time log level for Serial output. Messages above LOG_LEVEL are
+// removed by the compiler, format strings included, but their arguments are
+// still type-checked. The per-cycle sensor dump is LOG_LEVEL_DEBUG; build
+// with -DLOG_LEVEL=LOG_LEVEL_DEBUG to get it back.
+
+#include <Arduino.h>
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_ENABLED(level) (LOG_LEVEL >= (level))
+
+#define LOG_AT(level, ...)        \
+  do                              \
+  {                               \
+    if (LOG_ENABLED(level))       \
+      Serial.printf(__VA_ARGS__); \
+  } while (0)
+
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
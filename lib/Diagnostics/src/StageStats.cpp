@@ -0,0 +1,51 @@
+#include "StageStats.h"
+
+#include <stdio.h>
+
+size_t stageBucket(uint32_t us)
+{
+  size_t bucket = 0;
+  while (us > 1 && bucket < STAGE_BUCKETS - 1)
+  {
+    us >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+void StageStats::record(uint32_t us)
+{
+  buckets_[stageBucket(us)].fetch_add(1, std::memory_order_relaxed);
+  if (us > maxUs_.load(std::memory_order_relaxed))
+    maxUs_.store(us, std::memory_order_relaxed);
+}
+
+size_t StageStats::appendWindow(char *out, size_t capacity, const char *name)
+{
+  uint32_t counts[STAGE_BUCKETS];
+  uint32_t total = 0;
+  size_t used = 0;
+  for (size_t i = 0; i < STAGE_BUCKETS; i++)
+  {
+    uint32_t now = buckets_[i].load(std::memory_order_relaxed);
+    counts[i] = now - reported_[i];
+    reported_[i] = now;
+    total += counts[i];
+    if (counts[i])
+      used = i + 1;
+  }
+  uint32_t maxUs = maxUs_.exchange(0, std::memory_order_relaxed);
+
+  int n = snprintf(out, capacity, "\"%s\":[%lu,%lu", name, (unsigned long)total, (unsigned long)maxUs);
+  size_t length = n > 0 ? (size_t)n : 0;
+  for (size_t i = 0; i < used && length < capacity; i++)
+  {
+    n = snprintf(out + length, capacity - length, ",%lu", (unsigned long)counts[i]);
+    length += n > 0 ? (size_t)n : 0;
+  }
+  if (length + 1 >= capacity)
+    return 0;
+  out[length++] = ']';
+  out[length] = '\0';
+  return length;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+// Hot-path timing. A StageTimer reads the CPU cycle counter around one
+// stage (an I2C transfer, a publish, ...) and records the duration in that
+// stage's StageStats: a fixed log2 histogram plus the maximum, a few cycles
+// per sample and no allocation.
+//
+// Bucket 0 holds durations under 2 us, bucket i durations in
+// [2^i, 2^(i+1)) us, and the last bucket everything from 32.768 ms up.
+//
+// One task records into a StageStats and one (possibly another) reports it;
+// the counters are relaxed atomics, so the reporter may miss a sample that
+// lands while it reads, which then shows up in the next window.
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <Arduino.h>
+
+#define STAGE_BUCKETS 16
+
+size_t stageBucket(uint32_t us);
+
+class StageStats
+{
+public:
+  void record(uint32_t us);
+
+  // Appends "name":[count,maxUs,b0,b1,...] covering what was recorded since
+  // the last call, trailing empty buckets left out, and starts a new window.
+  // Returns the number of characters written, 0 if it did not fit (that
+  // window is then lost).
+  size_t appendWindow(char *out, size_t capacity, const char *name);
+
+private:
+  std::atomic<uint32_t> buckets_[STAGE_BUCKETS] = {};
+  std::atomic<uint32_t> maxUs_{0};
+  uint32_t reported_[STAGE_BUCKETS] = {}; // bucket counts at the last report
+};
+
+class StageTimer
+{
+public:
+  explicit StageTimer(StageStats &stats) : stats_(stats), start_(ESP.getCycleCount()) {}
+  ~StageTimer()
+  {
+    if (!discarded_)
+      stats_.record((ESP.getCycleCount() - start_) / ESP.getCpuFreqMHz());
+  }
+
+  // Records nothing for this stage, e.g. a poll that found no work.
+  void discard() { discarded_ = true; }
+
+  StageTimer(const StageTimer &) = delete;
+  StageTimer &operator=(const StageTimer &) = delete;
+
+private:
+  StageStats &stats_;
+  uint32_t start_;
+  bool discarded_ = false;
+};
@@ -0,0 +1,195 @@
+#include "TelemetryJournal.h"
+
+#include <string.h>
+
+namespace
+{
+  const size_t CONSUMED_OFFSET = 4 + TELEMETRY_FRAME_SIZE + 2;
+  const uint32_t SCAN_RECORDS = 8; // records per flash read while scanning
+
+  void put32(uint8_t *p, uint32_t v)
+  {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+  }
+
+  uint32_t get32(const uint8_t *p)
+  {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+  }
+
+  bool recordValid(const uint8_t *record)
+  {
+    uint16_t crc = (uint16_t)(record[CONSUMED_OFFSET - 2] | record[CONSUMED_OFFSET - 1] << 8);
+    return crc16Ccitt(record, CONSUMED_OFFSET - 2) == crc;
+  }
+}
+
+uint16_t crc16Ccitt(const uint8_t *data, size_t length)
+{
+  uint16_t crc = 0xFFFF;
+  while (length--)
+  {
+    crc ^= (uint16_t)(*data++) << 8;
+    for (int i = 0; i < 8; i++)
+      crc = crc & 0x8000 ? (uint16_t)(crc << 1 ^ 0x1021) : (uint16_t)(crc << 1);
+  }
+  return crc;
+}
+
+bool TelemetryJournal::begin(const char *partitionLabel)
+{
+  partition_ = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, partitionLabel);
+  if (!partition_ || partition_->size < 2 * JOURNAL_SECTOR_SIZE)
+  {
+    partition_ = nullptr;
+    return false;
+  }
+  slots_ = partition_->size / JOURNAL_SECTOR_SIZE * recordsPerSector_;
+
+  // Rebuild the ring: the newest valid record defines the head, the newest
+  // one marked consumed the tail.
+  uint32_t newest = 0;
+  uint32_t consumed = 0;
+  uint8_t records[SCAN_RECORDS * JOURNAL_RECORD_SIZE];
+  for (uint32_t slot = 0; slot < slots_;)
+  {
+    uint32_t n = recordsPerSector_ - slot % recordsPerSector_; // a read never crosses a sector
+    if (n > SCAN_RECORDS)
+      n = SCAN_RECORDS;
+    if (esp_partition_read(partition_, slotOffset(slot), records, n * JOURNAL_RECORD_SIZE) != ESP_OK)
+      return false;
+    for (uint32_t i = 0; i < n; i++, slot++)
+    {
+      const uint8_t *record = records + i * JOURNAL_RECORD_SIZE;
+      uint32_t seq = get32(record);
+      if (!recordValid(record) || seq % slots_ != slot)
+        continue;
+      if (seq > newest)
+        newest = seq;
+      if (record[CONSUMED_OFFSET] == 0 && seq > consumed)
+        consumed = seq;
+    }
+  }
+  headSeq_ = newest + 1;
+  // the oldest record left is the first of the sector after the head's, a
+  // lap ago
+  uint32_t headSector = headSeq_ - headSeq_ % slots_ % recordsPerSector_;
+  uint32_t oldest = headSector > slots_ - recordsPerSector_ ? headSector - (slots_ - recordsPerSector_) : 1;
+  tailSeq_ = consumed + 1 > oldest ? consumed + 1 : oldest;
+
+  // A write cut short by a reset leaves its slot half programmed; skip to a
+  // blank one (a sector is erased on entry anyway).
+  while (!sectorStart(headSeq_) && !slotBlank(headSeq_))
+    headSeq_++;
+  if (newest == 0)
+    tailSeq_ = headSeq_;
+  return true;
+}
+
+bool TelemetryJournal::slotBlank(uint32_t seq)
+{
+  uint8_t record[JOURNAL_RECORD_SIZE];
+  if (esp_partition_read(partition_, slotOffset(seq), record, sizeof(record)) != ESP_OK)
+    return false;
+  for (uint8_t b : record)
+    if (b != 0xFF)
+      return false;
+  return true;
+}
+
+// The head is about to write the first slot of a sector: what the sector
+// still holds from the previous lap is dropped, and it is erased unless it
+// is blank already (the first lap on a new partition).
+bool TelemetryJournal::enterSector(uint32_t seq)
+{
+  if (seq + recordsPerSector_ > slots_)
+  {
+    uint32_t keepFrom = seq + recordsPerSector_ - slots_;
+    if ((int32_t)(keepFrom - tailSeq_) > 0)
+    {
+      dropped_ += keepFrom - tailSeq_;
+      tailSeq_ = keepFrom;
+    }
+  }
+
+  size_t offset = slotOffset(seq);
+  uint8_t chunk[SCAN_RECORDS * JOURNAL_RECORD_SIZE];
+  bool blank = true;
+  for (size_t at = 0; at < JOURNAL_SECTOR_SIZE && blank; at += sizeof(chunk))
+  {
+    size_t n = JOURNAL_SECTOR_SIZE - at < sizeof(chunk) ? JOURNAL_SECTOR_SIZE - at : sizeof(chunk);
+    if (esp_partition_read(partition_, offset + at, chunk, n) != ESP_OK)
+      return false;
+    for (size_t i = 0; i < n && blank; i++)
+      blank = chunk[i] == 0xFF;
+  }
+  return blank || esp_partition_erase_range(partition_, offset, JOURNAL_SECTOR_SIZE) == ESP_OK;
+}
+
+bool TelemetryJournal::append(const uint8_t *frame)
+{
+  if (!partition_)
+    return false;
+  if (sectorStart(headSeq_) && !enterSector(headSeq_))
+    return false;
+
+  uint8_t record[JOURNAL_RECORD_SIZE];
+  memset(record, 0xFF, sizeof(record)); // the consumed byte stays programmable
+  put32(record, headSeq_);
+  memcpy(record + 4, frame, TELEMETRY_FRAME_SIZE);
+  uint16_t crc = crc16Ccitt(record, CONSUMED_OFFSET - 2);
+  record[CONSUMED_OFFSET - 2] = (uint8_t)crc;
+  record[CONSUMED_OFFSET - 1] = (uint8_t)(crc >> 8);
+
+  if (esp_partition_write(partition_, slotOffset(headSeq_), record, sizeof(record)) != ESP_OK)
+    return false;
+  headSeq_++;
+  return true;
+}
+
+bool TelemetryJournal::readRecord(uint32_t seq, uint8_t *frame)
+{
+  uint8_t record[JOURNAL_RECORD_SIZE];
+  if (esp_partition_read(partition_, slotOffset(seq), record, sizeof(record)) != ESP_OK)
+    return false;
+  if (!recordValid(record) || get32(record) != seq)
+    return false;
+  memcpy(frame, record + 4, TELEMETRY_FRAME_SIZE);
+  return true;
+}
+
+size_t TelemetryJournal::readBatch(uint8_t *out, size_t maxFrames)
+{
+  size_t frames = 0;
+  uint32_t seq = tailSeq_;
+  batchLastValid_ = 0;
+  // corrupt slots are skipped and consumed along with the batch
+  for (; seq != headSeq_ && frames < maxFrames; seq++)
+  {
+    if (readRecord(seq, out + frames * TELEMETRY_FRAME_SIZE))
+    {
+      frames++;
+      batchLastValid_ = seq;
+    }
+  }
+  batchEnd_ = seq;
+  return frames;
+}
+
+void TelemetryJournal::commitBatch()
+{
+  if (batchEnd_ == 0 || (int32_t)(batchEnd_ - tailSeq_) <= 0)
+    return;
+  tailSeq_ = batchEnd_;
+  batchEnd_ = 0;
+  // One byte programmed in place, no erase, on the last record that passed
+  // its CRC: begin() ignores the mark on a corrupt one. Corrupt slots past
+  // it are skipped again after a reboot, and replay nothing.
+  if (batchLastValid_ == 0)
+    return;
+  const uint8_t consumed = 0x00;
+  esp_partition_write(partition_, slotOffset(batchLastValid_) + CONSUMED_OFFSET, &consumed, 1);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+// Store-and-forward journal for telemetry frames taken while offline.
+//
+// Records go straight to a raw data partition (partitions.csv), used as a
+// ring of 4 KB sectors without a file system in between: each record is
+// programmed once into erased flash, and a sector is erased only when the
+// head moves into it, once per lap. Nothing is ever copied or rewritten.
+//
+// Each record carries a monotonically increasing journal sequence and a CRC;
+// on boot the ring is rebuilt by scanning the partition. Replay progress
+// needs no header either: committing a batch clears the consumed byte of its
+// last valid record, which NOR flash allows in place (a write can turn 1 bits into
+// 0 without an erase). When the head needs a sector that still holds
+// unconsumed records, they are dropped.
+//
+//  record: journal seq (uint32 LE) | frame (TELEMETRY_FRAME_SIZE) | CRC-16 |
+//          consumed (0xFF, 0x00 once replayed) | 0xFF padding to 4 bytes
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <TelemetryFrame.h>
+#include <esp_partition.h>
+
+#define JOURNAL_RECORD_SIZE ((4 + TELEMETRY_FRAME_SIZE + 2 + 1 + 3) / 4 * 4)
+#define JOURNAL_SECTOR_SIZE 4096
+
+class TelemetryJournal
+{
+public:
+  // Opens the data partition with this label and rebuilds the ring.
+  bool begin(const char *partitionLabel);
+
+  // Stores one encoded frame (TELEMETRY_FRAME_SIZE bytes).
+  bool append(const uint8_t *frame);
+
+  // Copies up to maxFrames of the oldest frames into out without removing
+  // them; commitBatch() removes what the last readBatch() returned.
+  size_t readBatch(uint8_t *out, size_t maxFrames);
+  void commitBatch();
+
+  uint32_t pending() const { return headSeq_ - tailSeq_; }
+  uint32_t dropped() const { return dropped_; }
+  bool ready() const { return partition_ != nullptr; }
+
+private:
+  bool readRecord(uint32_t seq, uint8_t *frame);
+  bool slotBlank(uint32_t seq);
+  bool enterSector(uint32_t seq);
+  bool sectorStart(uint32_t seq) const { return seq % slots_ % recordsPerSector_ == 0; }
+  size_t slotOffset(uint32_t seq) const
+  {
+    uint32_t slot = seq % slots_;
+    return (size_t)(slot / recordsPerSector_) * JOURNAL_SECTOR_SIZE +
+           (size_t)(slot % recordsPerSector_) * JOURNAL_RECORD_SIZE;
+  }
+
+  const esp_partition_t *partition_ = nullptr;
+  uint32_t slots_ = 0;
+  uint32_t recordsPerSector_ = JOURNAL_SECTOR_SIZE / JOURNAL_RECORD_SIZE;
+  uint32_t headSeq_ = 1; // next sequence to write
+  uint32_t tailSeq_ = 1; // oldest unconsumed sequence
+  uint32_t batchEnd_ = 0;
+  uint32_t batchLastValid_ = 0; // newest record of the batch that passed its CRC
+  uint32_t dropped_ = 0;
+};
+
+uint16_t crc16Ccitt(const uint8_t *data, size_t length);
@@ -0,0 +1,85 @@
+#include "MqttRouter.h"
+
+#include <math.h>
+#include <string.h>
+
+bool dispatchMqtt(const MqttRoute *routes, size_t count, const char *topic, const uint8_t *payload, size_t length)
+{
+  uint32_t hash = 2166136261u;
+  for (const char *p = topic; *p; p++)
+    hash = (hash ^ (uint8_t)*p) * 16777619u;
+
+  for (size_t i = 0; i < count; i++)
+  {
+    if (routes[i].hash == hash && strcmp(routes[i].topic, topic) == 0)
+    {
+      routes[i].handler(payload, length);
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t joinTopic(char *out, size_t capacity, const char *prefix, const char *topic)
+{
+  size_t prefixLength = strlen(prefix);
+  size_t topicLength = strlen(topic);
+  if (prefixLength + 1 + topicLength + 1 > capacity)
+    return 0;
+  memcpy(out, prefix, prefixLength);
+  out[prefixLength] = '/';
+  memcpy(out + prefixLength + 1, topic, topicLength + 1);
+  return prefixLength + 1 + topicLength;
+}
+
+const char *topicUnder(const char *topic, const char *prefix)
+{
+  size_t prefixLength = strlen(prefix);
+  if (strncmp(topic, prefix, prefixLength) != 0 || topic[prefixLength] != '/')
+    return nullptr;
+  return topic + prefixLength + 1;
+}
+
+bool payloadEquals(const uint8_t *payload, size_t length, const char *text)
+{
+  return strlen(text) == length && memcmp(payload, text, length) == 0;
+}
+
+size_t formatCenti(char *out, size_t capacity, float value)
+{
+  const char *special = isnan(value) ? "nan" : isinf(value) ? (value < 0 ? "-inf" : "inf") : nullptr;
+  // beyond this the float has no meaningful hundredths left anyway
+  if (!special && fabsf(value) >= 1e9f)
+    special = "ovf";
+  if (special)
+  {
+    size_t length = strlen(special);
+    if (length + 1 > capacity)
+      return 0;
+    memcpy(out, special, length + 1);
+    return length;
+  }
+
+  char digits[16];
+  size_t n = 0;
+  bool negative = value < 0;
+  uint64_t centi = (uint64_t)llround(fabs((double)value) * 100.0); // rounds like dtostrf()
+  do
+  {
+    digits[n++] = (char)('0' + centi % 10);
+    centi /= 10;
+    if (n == 2)
+      digits[n++] = '.';
+  } while (centi > 0 || n < 4); // at least "0.00"
+
+  size_t length = n + (negative ? 1 : 0);
+  if (length + 1 > capacity)
+    return 0;
+  size_t pos = 0;
+  if (negative)
+    out[pos++] = '-';
+  while (n > 0)
+    out[pos++] = digits[--n];
+  out[pos] = '\0';
+  return length;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+// Allocation-free MQTT message handling.
+//
+// Subscribed topics live in a constant table of MqttRoute entries whose
+// hashes are computed at compile time, so dispatching an incoming message is
+// one hash pass over the topic plus a strcmp() on a hit, with no String built
+// for either topic or payload. Payloads are parsed in place (they are not
+// NUL-terminated) and numbers are formatted into caller-provided buffers.
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef void (*MqttHandler)(const uint8_t *payload, size_t length);
+
+struct MqttRoute
+{
+  uint32_t hash;
+  const char *topic;
+  MqttHandler handler;
+};
+
+// 32-bit FNV-1a. Recursive so it stays a C++11 constexpr.
+constexpr uint32_t topicHash(const char *topic, uint32_t hash = 2166136261u)
+{
+  return *topic ? topicHash(topic + 1, (hash ^ (uint8_t)*topic) * 16777619u) : hash;
+}
+
+#define MQTT_ROUTE(topic, handler) {topicHash(topic), topic, handler}
+
+// Calls the handler routed for topic. Returns false if no route matches.
+bool dispatchMqtt(const MqttRoute *routes, size_t count, const char *topic, const uint8_t *payload, size_t length);
+
+// Per-device topics: "<prefix>/<topic>" into out. Returns the length, or 0 if
+// out is too small.
+size_t joinTopic(char *out, size_t capacity, const char *prefix, const char *topic);
+
+// The part of topic after "<prefix>/", or nullptr if it is not under prefix.
+const char *topicUnder(const char *topic, const char *prefix);
+
+bool payloadEquals(const uint8_t *payload, size_t length, const char *text);
+
+// Writes value with two decimals, as String(float) does ("-12.34", "nan").
+// Returns the length, or 0 if out is too small.
+size_t formatCenti(char *out, size_t capacity, float value);
@@ -0,0 +1,102 @@
+#include "MotionFeatures.h"
+
+#include <string.h>
+
+uint32_t isqrt64(uint64_t value)
+{
+  // bit-by-bit square root, no floating point
+  uint64_t result = 0;
+  uint64_t bit = 1ULL << 62;
+  while (bit > value)
+    bit >>= 2;
+  while (bit != 0)
+  {
+    if (value >= result + bit)
+    {
+      value -= result + bit;
+      result = (result >> 1) + bit;
+    }
+    else
+    {
+      result >>= 1;
+    }
+    bit >>= 2;
+  }
+  return (uint32_t)result;
+}
+
+void MotionWindow::reset()
+{
+  count_ = 0;
+  memset(&last_, 0, sizeof(last_));
+  memset(peakAbs_, 0, sizeof(peakAbs_));
+  memset(sumSquares_, 0, sizeof(sumSquares_));
+  peakMagnitudeSq_ = 0;
+  sumMagnitudeSq_ = 0;
+  peakDynamicSq_ = 0;
+}
+
+void MotionWindow::add(const ImuSample &sample)
+{
+  const int16_t *axes[2] = {sample.accel, sample.gyro};
+  for (int i = 0; i < 6; i++)
+  {
+    int32_t v = axes[i / 3][i % 3];
+    uint16_t magnitude = (uint16_t)(v < 0 ? -v : v);
+    if (magnitude > peakAbs_[i])
+      peakAbs_[i] = magnitude;
+    sumSquares_[i] += (uint64_t)(v * v);
+  }
+
+  int32_t ax = sample.accel[0], ay = sample.accel[1], az = sample.accel[2];
+  uint32_t magnitudeSq = (uint32_t)(ax * ax) + (uint32_t)(ay * ay) + (uint32_t)(az * az);
+  if (magnitudeSq > peakMagnitudeSq_)
+    peakMagnitudeSq_ = magnitudeSq;
+  sumMagnitudeSq_ += magnitudeSq;
+
+  // against the estimate before this sample, so a shock is not half absorbed
+  if (!gravityPrimed_)
+  {
+    for (int i = 0; i < 3; i++)
+      gravityQ8_[i] = sample.accel[i] * 256;
+    gravityPrimed_ = true;
+  }
+  uint64_t dynamicSq = 0;
+  for (int i = 0; i < 3; i++)
+  {
+    int32_t a = sample.accel[i];
+    int64_t d = a - gravityQ8_[i] / 256;
+    dynamicSq += (uint64_t)(d * d);
+    gravityQ8_[i] += (a * 256 - gravityQ8_[i]) >> gravityShift_;
+  }
+  if (dynamicSq > peakDynamicSq_)
+    peakDynamicSq_ = dynamicSq;
+
+  last_ = sample;
+  count_++;
+}
+
+uint16_t MotionWindow::peakExcess() const
+{
+  if (count_ == 0)
+    return 0;
+  uint32_t peak = isqrt64(peakMagnitudeSq_);
+  uint32_t rms = isqrt64(sumMagnitudeSq_ / count_);
+  return (uint16_t)(peak - rms); // peak >= rms
+}
+
+void MotionWindow::finish(MotionFeatures &out)
+{
+  out.samples = count_;
+  out.last = last_;
+  for (int i = 0; i < 6; i++)
+  {
+    out.peakAbs[i] = peakAbs_[i];
+    out.rms[i] = count_ ? (uint16_t)isqrt64(sumSquares_[i] / count_) : 0;
+  }
+  out.accelPeakMagnitude = (uint16_t)isqrt64(peakMagnitudeSq_);
+  out.accelRmsMagnitude = count_ ? (uint16_t)isqrt64(sumMagnitudeSq_ / count_) : 0;
+  uint32_t dynamicPeak = isqrt64(peakDynamicSq_);
+  out.dynamicPeakMagnitude = dynamicPeak > 0xFFFF ? 0xFFFF : (uint16_t)dynamicPeak;
+  reset();
+}
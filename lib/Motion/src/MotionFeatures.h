@@ -0,0 +1,63 @@
+#pragma once
+
+// Integer feature extraction over a window of IMU samples, so one 5 s report
+// summarises every sample the FIFO delivered instead of a single snapshot.
+//
+// Gravity is tracked by a first-order low-pass of the accelerometer
+// (weight 2^-gravityShift per sample) that runs across windows; each sample
+// minus the estimate so far is the dynamic acceleration, whose magnitude does
+// not depend on how the board is mounted or tilted.
+
+#include <stdint.h>
+
+struct ImuSample
+{
+  int16_t accel[3];
+  int16_t gyro[3];
+};
+
+struct MotionFeatures
+{
+  uint32_t samples;
+  ImuSample last;
+  uint16_t peakAbs[6]; // |AcX| |AcY| |AcZ| |GyX| |GyY| |GyZ|
+  uint16_t rms[6];
+  uint16_t accelPeakMagnitude; // max of sqrt(ax^2 + ay^2 + az^2)
+  uint16_t accelRmsMagnitude;
+  uint16_t dynamicPeakMagnitude; // max |a - gravity|, saturating
+};
+
+class MotionWindow
+{
+public:
+  // gravityShift 8 follows a tilt within ~0.5 s at 500 Hz; a window of one
+  // register snapshot needs a much larger weight.
+  explicit MotionWindow(uint8_t gravityShift = 8) : gravityShift_(gravityShift) { reset(); }
+
+  void add(const ImuSample &sample);
+
+  // Peak |a| above RMS |a| of the samples added so far, in raw counts: how
+  // far the window rose above its own baseline (~1 g at rest). 0 if empty.
+  uint16_t peakExcess() const;
+
+  // Writes the features of the samples added since the last call and starts
+  // a new window. samples == 0 means nothing was acquired.
+  void finish(MotionFeatures &out);
+
+private:
+  void reset();
+
+  uint32_t count_;
+  ImuSample last_;
+  uint16_t peakAbs_[6];
+  uint64_t sumSquares_[6];
+  uint32_t peakMagnitudeSq_;
+  uint64_t sumMagnitudeSq_;
+  uint64_t peakDynamicSq_;
+
+  uint8_t gravityShift_;
+  bool gravityPrimed_ = false;
+  int32_t gravityQ8_[3]; // kept across windows
+};
+
+uint32_t isqrt64(uint64_t value);
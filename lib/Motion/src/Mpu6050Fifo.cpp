@@ -0,0 +1,112 @@
+#include "Mpu6050Fifo.h"
+
+#include <Wire.h>
+
+namespace
+{
+  const uint8_t REG_SMPLRT_DIV = 0x19;
+  const uint8_t REG_CONFIG = 0x1A;
+  const uint8_t REG_FIFO_EN = 0x23;
+  const uint8_t REG_USER_CTRL = 0x6A;
+  const uint8_t REG_FIFO_COUNTH = 0x72;
+  const uint8_t REG_FIFO_R_W = 0x74;
+
+  const uint8_t FIFO_EN_ACCEL_GYRO = 0x78; // XG | YG | ZG | ACCEL
+  const uint8_t USER_CTRL_FIFO_EN = 0x40;
+  const uint8_t USER_CTRL_FIFO_RESET = 0x04;
+  const uint8_t CONFIG_DLPF_184HZ = 0x01;
+
+  // Largest burst that fits the ESP32 Wire buffer (128 bytes) in whole records.
+  const size_t BURST_RECORDS = 10;
+}
+
+size_t parseFifoRecords(const uint8_t *data, size_t length, ImuRing &ring)
+{
+  size_t records = length / MPU_FIFO_RECORD_SIZE;
+  for (size_t r = 0; r < records; r++)
+  {
+    const uint8_t *p = data + r * MPU_FIFO_RECORD_SIZE;
+    ImuSample sample;
+    for (int i = 0; i < 3; i++)
+    {
+      sample.accel[i] = (int16_t)(p[2 * i] << 8 | p[2 * i + 1]);
+      sample.gyro[i] = (int16_t)(p[6 + 2 * i] << 8 | p[6 + 2 * i + 1]);
+    }
+    ring.push(sample);
+  }
+  return records;
+}
+
+bool Mpu6050Fifo::writeRegister(uint8_t reg, uint8_t value)
+{
+  wire_.beginTransmission(address_);
+  wire_.write(reg);
+  wire_.write(value);
+  return wire_.endTransmission(true) == 0;
+}
+
+bool Mpu6050Fifo::readRegisters(uint8_t reg, uint8_t *out, size_t length)
+{
+  wire_.beginTransmission(address_);
+  wire_.write(reg);
+  if (wire_.endTransmission(false) != 0)
+    return false;
+  if (wire_.requestFrom(address_, length, true) != length)
+    return false;
+  for (size_t i = 0; i < length; i++)
+    out[i] = (uint8_t)wire_.read();
+  return true;
+}
+
+void Mpu6050Fifo::resetFifo()
+{
+  writeRegister(REG_USER_CTRL, USER_CTRL_FIFO_RESET);
+  writeRegister(REG_USER_CTRL, USER_CTRL_FIFO_EN);
+}
+
+bool Mpu6050Fifo::begin(uint16_t sampleRateHz)
+{
+  if (sampleRateHz == 0 || sampleRateHz > 1000)
+    return false;
+  uint8_t divider = (uint8_t)(1000 / sampleRateHz - 1);
+  bool ok = writeRegister(REG_CONFIG, CONFIG_DLPF_184HZ) && writeRegister(REG_SMPLRT_DIV, divider) &&
+            writeRegister(REG_FIFO_EN, FIFO_EN_ACCEL_GYRO);
+  if (ok)
+    resetFifo();
+  return ok;
+}
+
+int Mpu6050Fifo::drain(ImuRing &ring)
+{
+  uint8_t countBytes[2];
+  if (!readRegisters(REG_FIFO_COUNTH, countBytes, sizeof(countBytes)))
+  {
+    busErrors_++;
+    return -1;
+  }
+  size_t count = (size_t)(countBytes[0] << 8 | countBytes[1]);
+  if (count >= MPU_FIFO_CAPACITY)
+  {
+    overflows_++;
+    resetFifo();
+    return 0;
+  }
+
+  int records = 0;
+  uint8_t burst[BURST_RECORDS * MPU_FIFO_RECORD_SIZE];
+  while (count >= MPU_FIFO_RECORD_SIZE)
+  {
+    size_t n = count / MPU_FIFO_RECORD_SIZE;
+    if (n > BURST_RECORDS)
+      n = BURST_RECORDS;
+    size_t length = n * MPU_FIFO_RECORD_SIZE;
+    if (!readRegisters(REG_FIFO_R_W, burst, length))
+    {
+      busErrors_++;
+      return -1;
+    }
+    records += (int)parseFifoRecords(burst, length, ring);
+    count -= length;
+  }
+  return records;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+// MPU6050 FIFO acquisition: the chip samples accel + gyro at a fixed rate
+// into its 1 KiB FIFO, and drain() empties it in I2C burst reads into a ring
+// buffer. Between drains nothing has to happen on the ESP32, so short shocks
+// are captured without polling at the sample rate.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <SpscRing.h>
+
+#include "MotionFeatures.h"
+
+class TwoWire;
+
+#define IMU_RING_SIZE 256
+typedef SpscRing<ImuSample, IMU_RING_SIZE> ImuRing;
+
+// One FIFO record: AcX AcY AcZ GyX GyY GyZ, big-endian int16.
+#define MPU_FIFO_RECORD_SIZE 12
+#define MPU_FIFO_CAPACITY 1024
+
+// Parses whole records from a FIFO burst into the ring; trailing partial
+// bytes are ignored. Returns the number of records parsed.
+size_t parseFifoRecords(const uint8_t *data, size_t length, ImuRing &ring);
+
+class Mpu6050Fifo
+{
+public:
+  Mpu6050Fifo(TwoWire &wire, uint8_t address) : wire_(wire), address_(address) {}
+
+  // Sets the sample-rate divider for sampleRateHz (gyro output rate 1 kHz
+  // with the DLPF on), enables accel + gyro into the FIFO and resets it.
+  bool begin(uint16_t sampleRateHz);
+
+  // Moves every complete record out of the FIFO. On overflow the FIFO is
+  // reset (records would be misaligned) and the window loses those samples.
+  // Returns the number of records read, -1 on a bus error.
+  int drain(ImuRing &ring);
+
+  uint32_t overflows() const { return overflows_; }
+  uint32_t busErrors() const { return busErrors_; }
+
+private:
+  bool writeRegister(uint8_t reg, uint8_t value);
+  bool readRegisters(uint8_t reg, uint8_t *out, size_t length);
+  void resetFifo();
+
+  TwoWire &wire_;
+  uint8_t address_;
+  uint32_t overflows_ = 0;
+  uint32_t busErrors_ = 0;
+};
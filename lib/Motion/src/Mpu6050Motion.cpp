@@ -0,0 +1,35 @@
+#include "Mpu6050Motion.h"
+
+#include <Wire.h>
+
+namespace
+{
+  const uint8_t REG_ACCEL_CONFIG = 0x1C;
+  const uint8_t REG_MOT_THR = 0x1F;
+  const uint8_t REG_MOT_DUR = 0x20;
+  const uint8_t REG_INT_PIN_CFG = 0x37;
+  const uint8_t REG_INT_ENABLE = 0x38;
+
+  const uint8_t ACCEL_CONFIG_2G_HPF_5HZ = 0x01;
+  const uint8_t INT_PIN_CFG_PULSE_HIGH = 0x00; // active high, push-pull, 50 us pulse
+  const uint8_t INT_ENABLE_MOT = 0x40;
+
+  bool writeRegister(TwoWire &wire, uint8_t address, uint8_t reg, uint8_t value)
+  {
+    wire.beginTransmission(address);
+    wire.write(reg);
+    wire.write(value);
+    return wire.endTransmission(true) == 0;
+  }
+}
+
+bool enableMpuMotionInterrupt(TwoWire &wire, uint8_t address, uint16_t thresholdMg, uint8_t durationMs)
+{
+  if (thresholdMg > MPU_MOTION_THRESHOLD_MAX_MG)
+    thresholdMg = MPU_MOTION_THRESHOLD_MAX_MG;
+  return writeRegister(wire, address, REG_ACCEL_CONFIG, ACCEL_CONFIG_2G_HPF_5HZ) &&
+         writeRegister(wire, address, REG_MOT_THR, (uint8_t)(thresholdMg / 2)) &&
+         writeRegister(wire, address, REG_MOT_DUR, durationMs) &&
+         writeRegister(wire, address, REG_INT_PIN_CFG, INT_PIN_CFG_PULSE_HIGH) &&
+         writeRegister(wire, address, REG_INT_ENABLE, INT_ENABLE_MOT);
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+// MPU6050 motion-detect interrupt. The chip high-pass filters its
+// accelerometer and counts how long any axis stays beyond MOT_THR; when that
+// reaches MOT_DUR it pulses INT (50 us, active high, push-pull) and sets
+// MOT_INT in INT_STATUS. Routed to a GPIO interrupt, it tells the ESP32 that
+// something moved without anyone reading the chip in the meantime.
+
+#include <stdint.h>
+
+class TwoWire;
+
+#define MPU_MOTION_THRESHOLD_MAX_MG 510 // MOT_THR: 8 bits of 2 mg at +-2 g
+#define MPU_MOTION_DURATION_MAX_MS 255  // MOT_DUR: 8 bits of 1 ms
+
+// Enables the motion interrupt with the 5 Hz high-pass filter, which takes
+// gravity and slow tilts out. The accelerometer stays at +-2 g. A threshold
+// above the maximum is clamped. Returns false on a bus error.
+bool enableMpuMotionInterrupt(TwoWire &wire, uint8_t address, uint16_t thresholdMg, uint8_t durationMs);
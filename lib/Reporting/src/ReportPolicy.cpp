@@ -0,0 +1,35 @@
+#include "ReportPolicy.h"
+
+#include <math.h>
+
+bool ReportChannel::due(float value, uint32_t nowMs) const
+{
+  if (isnan(value))
+    return false;
+  if (!hasPublished_)
+    return true;
+  if (policy_.maxSilenceMs && nowMs - lastPublishMs_ >= policy_.maxSilenceMs)
+    return true;
+  float deadband = fmaxf(policy_.absoluteDeadband, policy_.relativeDeadband * fabsf(lastValue_));
+  return fabsf(value - lastValue_) >= deadband;
+}
+
+void ReportChannel::published(float value, uint32_t nowMs)
+{
+  if (isnan(value))
+    return;
+  hasPublished_ = true;
+  lastValue_ = value;
+  lastPublishMs_ = nowMs;
+}
+
+bool HysteresisAlert::update(float value)
+{
+  if (isnan(value))
+    return active_;
+  if (direction_ == ABOVE)
+    active_ = active_ ? value >= exit_ : value > enter_;
+  else
+    active_ = active_ ? value <= exit_ : value < enter_;
+  return active_;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+// Report-by-exception building blocks.
+//
+// ReportChannel decides whether a value is worth publishing: it goes out when
+// it moved from the last published value by more than the deadband (absolute,
+// or relative to the last value, whichever is larger) or when the channel has
+// been silent for maxSilenceMs (heartbeat). Alert states are channels with a
+// deadband below 1 so every 0/1 change is published.
+//
+// HysteresisAlert is a comparator with separate enter and exit levels so a
+// value hovering around a threshold does not flap the alert.
+
+#include <stdint.h>
+
+struct ReportPolicy
+{
+  float absoluteDeadband;
+  float relativeDeadband; // fraction of the last published value
+  uint32_t maxSilenceMs;  // 0 = no heartbeat
+};
+
+class ReportChannel
+{
+public:
+  explicit ReportChannel(const ReportPolicy &policy) : policy_(policy) {}
+
+  // NaN is never due; a failed read is not a change.
+  bool due(float value, uint32_t nowMs) const;
+  void published(float value, uint32_t nowMs);
+
+private:
+  ReportPolicy policy_;
+  bool hasPublished_ = false;
+  float lastValue_ = 0.0f;
+  uint32_t lastPublishMs_ = 0;
+};
+
+class HysteresisAlert
+{
+public:
+  enum Direction
+  {
+    ABOVE, // enters when value > enter, exits when value < exit
+    BELOW  // enters when value < enter, exits when value > exit
+  };
+
+  HysteresisAlert(Direction direction, float enter, float exit)
+      : direction_(direction), enter_(enter), exit_(exit) {}
+
+  // NaN leaves the state unchanged. Returns the new state.
+  bool update(float value);
+  bool active() const { return active_; }
+
+  // New levels apply from the next update(); the state is kept.
+  void setLevels(float enter, float exit)
+  {
+    enter_ = enter;
+    exit_ = exit;
+  }
+
+private:
+  Direction direction_;
+  float enter_;
+  float exit_;
+  bool active_ = false;
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+// Fixed-capacity single-producer/single-consumer ring buffer. Lock-free: the
+// producer only writes head_, the consumer only writes tail_, so one side may
+// run in another task or an ISR without a mutex. N must be a power of two;
+// one slot is never used so full and empty can be told apart.
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+template <typename T, size_t N>
+class SpscRing
+{
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing capacity must be a power of two");
+
+public:
+  // Producer side. Returns false (and counts a drop) when full. Always
+  // inlined, so a push from an IRAM_ATTR ISR never calls into flash.
+  __attribute__((always_inline)) bool push(const T &item)
+  {
+    size_t head = head_.load(std::memory_order_relaxed);
+    size_t next = (head + 1) & (N - 1);
+    if (next == tail_.load(std::memory_order_acquire))
+    {
+      drops_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    slots_[head] = item;
+    head_.store(next, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side.
+  bool pop(T &item)
+  {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire))
+      return false;
+    item = slots_[tail];
+    tail_.store((tail + 1) & (N - 1), std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side: copies the oldest item without removing it.
+  bool peek(T &item) const
+  {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire))
+      return false;
+    item = slots_[tail];
+    return true;
+  }
+
+  size_t size() const
+  {
+    return (head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire)) & (N - 1);
+  }
+
+  static constexpr size_t capacity() { return N - 1; }
+  uint32_t drops() const { return drops_.load(std::memory_order_relaxed); }
+
+private:
+  T slots_[N];
+  std::atomic<size_t> head_{0};
+  std::atomic<size_t> tail_{0};
+  std::atomic<uint32_t> drops_{0};
+};
@@ -0,0 +1,33 @@
+#include "AdaptivePeriod.h"
+
+#include <math.h>
+
+void AdaptivePeriod::reset()
+{
+  periodMs_ = policy_.minMs;
+  quietRun_ = 0;
+}
+
+uint32_t AdaptivePeriod::update(float activity)
+{
+  if (isnan(activity))
+    return periodMs_;
+  if (activity >= 1.0f)
+  {
+    periodMs_ = policy_.minMs;
+    quietRun_ = 0;
+  }
+  else if (activity < policy_.quietBelow)
+  {
+    if (++quietRun_ >= policy_.quietSamples)
+    {
+      quietRun_ = 0;
+      periodMs_ = periodMs_ > policy_.maxMs / 2 ? policy_.maxMs : periodMs_ * 2;
+    }
+  }
+  else
+  {
+    quietRun_ = 0;
+  }
+  return periodMs_;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+// Activity-driven sampling period for one sensor.
+//
+// The caller scores each sample's activity against the sensor's own
+// threshold (1.0 = "something is happening"). An active sample snaps the
+// period to minMs at once, so an event is followed at full resolution from
+// its first sample; quietSamples quiet ones in a row (activity below
+// quietBelow) double it, up to maxMs. Anything in between holds the period,
+// which keeps a signal hovering near the threshold from see-sawing.
+
+#include <stdint.h>
+
+struct SamplingPolicy
+{
+  uint32_t minMs;
+  uint32_t maxMs;
+  float quietBelow;     // activity under this counts as quiet
+  uint8_t quietSamples; // quiet samples in a row before each doubling
+};
+
+class AdaptivePeriod
+{
+public:
+  explicit AdaptivePeriod(const SamplingPolicy &policy) : policy_(policy) { reset(); }
+
+  // Back to the shortest period, as after boot.
+  void reset();
+
+  // Feeds one sample's activity score; returns the new period. NaN (a
+  // failed read) changes nothing.
+  uint32_t update(float activity);
+
+  uint32_t periodMs() const { return periodMs_; }
+  const SamplingPolicy &policy() const { return policy_; }
+
+private:
+  SamplingPolicy policy_;
+  uint32_t periodMs_;
+  uint8_t quietRun_;
+};
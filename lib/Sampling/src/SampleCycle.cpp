@@ -0,0 +1,114 @@
+#include "SampleCycle.h"
+
+#include <math.h>
+
+SampleCycle::SampleCycle(const SamplingPolicy &climate, const SamplingPolicy &motion, DetectorState &detectors)
+    : climate_(climate), motion_(motion), tempLow_(HysteresisAlert::BELOW, 0, 0),
+      tempHigh_(HysteresisAlert::ABOVE, 0, 0), humHigh_(HysteresisAlert::ABOVE, 0, 0),
+      tempAnomaly_(DEFAULT_ALERT_CONFIG.temp, detectors.temp), humAnomaly_(DEFAULT_ALERT_CONFIG.hum, detectors.hum),
+      motionAnomaly_(DEFAULT_ALERT_CONFIG.motion, detectors.motion)
+{
+  resetSampling();
+  applyConfig(DEFAULT_ALERT_CONFIG);
+}
+
+void SampleCycle::applyConfig(const AlertConfig &config)
+{
+  tempLow_.setLevels(config.tempMin, config.tempMin + TEMP_HYSTERESIS);
+  tempHigh_.setLevels(config.tempMax, config.tempMax - TEMP_HYSTERESIS);
+  humHigh_.setLevels(config.humMax, config.humMax - HUM_HYSTERESIS);
+  tempAnomaly_.setPolicy(config.temp);
+  humAnomaly_.setPolicy(config.hum);
+  motionAnomaly_.setPolicy(config.motion);
+}
+
+void SampleCycle::resetSampling()
+{
+  climate_.reset();
+  motion_.reset();
+  temp_ = hum_ = NAN;
+  rateTemp_ = rateHum_ = NAN;
+}
+
+void SampleCycle::resetDetectors()
+{
+  tempAnomaly_.reset();
+  humAnomaly_.reset();
+  motionAnomaly_.reset();
+}
+
+void SampleCycle::resumeAt(uint32_t nowMs, uint32_t afterMs)
+{
+  lastClimateMs_ = nowMs - climate_.periodMs() + afterMs;
+  lastMotionMs_ = nowMs - motion_.periodMs() + afterMs;
+}
+
+// Rate of change of a new reading against the reference one, scored against
+// the active rates. NaN for a failed read.
+float SampleCycle::climateActivity(float temp, float hum, uint32_t nowMs)
+{
+  if (isnan(temp) || isnan(hum))
+    return NAN;
+  float activity = 0.0f;
+  if (!isnan(rateTemp_))
+  {
+    uint32_t span = nowMs - rateSinceMs_;
+    float minutes = (span > RATE_MIN_SPAN_MS ? span : RATE_MIN_SPAN_MS) / 60000.0f;
+    activity = fmaxf(fabsf(temp - rateTemp_) / minutes / TEMP_ACTIVE_RATE,
+                     fabsf(hum - rateHum_) / minutes / HUM_ACTIVE_RATE);
+  }
+  rateTemp_ = temp;
+  rateHum_ = hum;
+  rateSinceMs_ = nowMs;
+  return activity;
+}
+
+void SampleCycle::update(uint32_t nowMs, bool climateDue, float temp, float hum, const MotionFeatures &window,
+                         TelemetrySample &sample)
+{
+  bool mpuValid = window.samples > 0;
+  if (climateDue)
+  {
+    lastClimateMs_ = nowMs;
+    temp_ = temp;
+    hum_ = hum;
+    climate_.update(climateActivity(temp, hum, nowMs));
+  }
+  lastMotionMs_ = nowMs;
+  bool dhtValid = !isnan(temp_) && !isnan(hum_);
+
+  bool motionAlert = motionAnomaly_.active();
+  if (mpuValid)
+    motionAlert = motionAnomaly_.update(window.dynamicPeakMagnitude);
+  // each reading is scored once, not again on every motion-only record
+  if (climateDue && dhtValid)
+  {
+    tempAnomaly_.update(lroundf(temp_ * 100));
+    humAnomaly_.update(lroundf(hum_ * 100));
+  }
+
+  // A register snapshot has no window to measure, so there the alert stands
+  // in for the peak above RMS.
+  float motionActivity = NAN;
+  if (mpuValid)
+    motionActivity = motionAlert ? 1.0f
+                                 : (window.accelPeakMagnitude - window.accelRmsMagnitude) / MOTION_ACTIVE_EXCESS;
+  motion_.update(motionActivity);
+
+  tempLow_.update(temp_);
+  tempHigh_.update(temp_);
+  humHigh_.update(hum_);
+  bool climateAlert = tempLow_.active() || tempHigh_.active() || humHigh_.active() || tempAnomaly_.active() ||
+                      humAnomaly_.active();
+
+  sample.deviceMs = nowMs;
+  sample.flags = (motionAlert ? FRAME_MOTION_ALERT : 0) | (climateAlert ? FRAME_CLIMATE_ALERT : 0) |
+                 (dhtValid ? FRAME_DHT_VALID : 0) | (mpuValid ? FRAME_MPU_VALID : 0);
+  sample.temperature = temp_;
+  sample.humidity = hum_;
+  sample.windowSamples = window.samples > 0xFFFF ? 0xFFFF : (uint16_t)window.samples;
+  sample.accelPeakMagnitude = window.accelPeakMagnitude;
+  sample.accelRmsMagnitude = window.accelRmsMagnitude;
+  sample.climatePeriodMs = climate_.periodMs();
+  sample.motionPeriodMs = motion_.periodMs();
+}
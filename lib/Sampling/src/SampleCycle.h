@@ -0,0 +1,88 @@
+#pragma once
+
+// The acquisition side's decisions for one board, without the hardware: when
+// the climate and motion channels are due, the limit alerts and anomaly
+// detectors, and how both sampling periods adapt. The firmware feeds it DHT11
+// readings and closed IMU windows, the fleet load generator (bench/fleet)
+// simulated ones, so both sample and alert the same way.
+//
+// Each record closes the motion window; the climate is read only when its
+// period is up, and records in between carry the last reading. The detector
+// statistics are plain data (DetectorState) owned by the caller, so the
+// firmware can keep them in RTC memory across deep sleep.
+
+#include <stdint.h>
+
+#include <AdaptivePeriod.h>
+#include <MotionFeatures.h>
+#include <TelemetryFrame.h>
+
+#include "TelemetryPolicy.h"
+
+struct DetectorState
+{
+  AnomalyState temp;
+  AnomalyState hum;
+  AnomalyState motion;
+};
+
+class SampleCycle
+{
+public:
+  SampleCycle(const SamplingPolicy &climate, const SamplingPolicy &motion, DetectorState &detectors);
+
+  // Limits and detector policies for the next samples. An active alert stays
+  // active until a sample clears it, and the detectors keep what they learnt.
+  void applyConfig(const AlertConfig &config);
+
+  // Back to the shortest periods with no climate history, as after power-on.
+  void resetSampling();
+  // Forgets what the detectors learnt (cold boot).
+  void resetDetectors();
+  // The first record after a wake comes afterMs from now instead of a full
+  // period later.
+  void resumeAt(uint32_t nowMs, uint32_t afterMs);
+
+  bool climateDue(uint32_t nowMs) const { return nowMs - lastClimateMs_ >= climate_.periodMs(); }
+  bool motionDue(uint32_t nowMs) const { return nowMs - lastMotionMs_ >= motion_.periodMs(); }
+  // Whether a motion event may close the window now: not within
+  // MOTION_EVENT_GAP_MS of the last record.
+  bool motionEventAllowed(uint32_t nowMs) const { return nowMs - lastMotionMs_ >= MOTION_EVENT_GAP_MS; }
+  // Without a motion interrupt: whether the window filled so far (its peak
+  // |a| above RMS, raw counts) is worth closing before the period is up.
+  bool motionBurst(uint16_t peakExcess) const
+  {
+    return motion_.periodMs() > motion_.policy().minMs && peakExcess >= MOTION_ACTIVE_EXCESS;
+  }
+
+  // One record: when climateDue, takes the new reading (NaN for a failed
+  // read) and scores it once; scores the closed window (samples == 0 for a
+  // failed acquisition); evaluates every alert and adapts both periods.
+  // Fills everything in sample but seq and the raw accel/gyro snapshot.
+  void update(uint32_t nowMs, bool climateDue, float temp, float hum, const MotionFeatures &window,
+              TelemetrySample &sample);
+
+  uint32_t climatePeriodMs() const { return climate_.periodMs(); }
+  uint32_t motionPeriodMs() const { return motion_.periodMs(); }
+  bool motionAlert() const { return motionAnomaly_.active(); }
+
+private:
+  float climateActivity(float temp, float hum, uint32_t nowMs);
+
+  AdaptivePeriod climate_;
+  AdaptivePeriod motion_;
+  uint32_t lastClimateMs_ = 0;
+  uint32_t lastMotionMs_ = 0;
+  float temp_; // latest reading, carried by records in between
+  float hum_;
+  float rateTemp_; // reference reading for the rate of change
+  float rateHum_;
+  uint32_t rateSinceMs_ = 0;
+
+  HysteresisAlert tempLow_;
+  HysteresisAlert tempHigh_;
+  HysteresisAlert humHigh_;
+  AnomalyChannel tempAnomaly_;
+  AnomalyChannel humAnomaly_;
+  AnomalyChannel motionAnomaly_;
+};
@@ -0,0 +1,90 @@
+#include "TelemetryFrame.h"
+
+#include <math.h>
+
+namespace
+{
+  void put16(uint8_t *p, uint16_t v)
+  {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+  }
+
+  void put32(uint8_t *p, uint32_t v)
+  {
+    put16(p, (uint16_t)v);
+    put16(p + 2, (uint16_t)(v >> 16));
+  }
+
+  uint16_t get16(const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+  uint32_t get32(const uint8_t *p) { return get16(p) | ((uint32_t)get16(p + 2) << 16); }
+
+  // Scales to hundredths and clamps into the field range; NaN encodes as 0
+  // (the valid flag tells the reader whether to trust the value).
+  int32_t toCenti(float value, int32_t lo, int32_t hi)
+  {
+    if (isnan(value))
+      return 0;
+    float scaled = roundf(value * 100.0f);
+    if (scaled < (float)lo)
+      return lo;
+    if (scaled > (float)hi)
+      return hi;
+    return (int32_t)scaled;
+  }
+
+  uint16_t toDeciseconds(uint32_t ms)
+  {
+    uint32_t ds = (ms + 50) / 100;
+    return ds > UINT16_MAX ? UINT16_MAX : (uint16_t)ds;
+  }
+}
+
+size_t encodeTelemetryFrame(const TelemetrySample &sample, uint8_t *out, size_t capacity)
+{
+  if (capacity < TELEMETRY_FRAME_SIZE)
+    return 0;
+  out[0] = TELEMETRY_FRAME_VERSION;
+  out[1] = sample.flags;
+  put16(out + 2, sample.seq);
+  put32(out + 4, sample.deviceMs);
+  put16(out + 8, (uint16_t)(int16_t)toCenti(sample.temperature, INT16_MIN, INT16_MAX));
+  put16(out + 10, (uint16_t)toCenti(sample.humidity, 0, UINT16_MAX));
+  for (int i = 0; i < 3; i++)
+  {
+    put16(out + 12 + 2 * i, (uint16_t)sample.accel[i]);
+    put16(out + 18 + 2 * i, (uint16_t)sample.gyro[i]);
+  }
+  put16(out + 24, sample.windowSamples);
+  put16(out + 26, sample.accelPeakMagnitude);
+  put16(out + 28, sample.accelRmsMagnitude);
+  put16(out + 30, toDeciseconds(sample.climatePeriodMs));
+  put16(out + 32, toDeciseconds(sample.motionPeriodMs));
+  return TELEMETRY_FRAME_SIZE;
+}
+
+bool decodeTelemetryFrame(const uint8_t *in, size_t length, TelemetrySample &sample)
+{
+  if (length < TELEMETRY_FRAME_V1_SIZE || in[0] < 1 || in[0] > TELEMETRY_FRAME_VERSION)
+    return false;
+  if ((in[0] == 2 && length < TELEMETRY_FRAME_V2_SIZE) || (in[0] >= 3 && length < TELEMETRY_FRAME_SIZE))
+    return false;
+  sample.flags = in[1];
+  sample.seq = get16(in + 2);
+  sample.deviceMs = get32(in + 4);
+  sample.temperature = (int16_t)get16(in + 8) / 100.0f;
+  sample.humidity = get16(in + 10) / 100.0f;
+  for (int i = 0; i < 3; i++)
+  {
+    sample.accel[i] = (int16_t)get16(in + 12 + 2 * i);
+    sample.gyro[i] = (int16_t)get16(in + 18 + 2 * i);
+  }
+  bool v2 = in[0] >= 2;
+  sample.windowSamples = v2 ? get16(in + 24) : 0;
+  sample.accelPeakMagnitude = v2 ? get16(in + 26) : 0;
+  sample.accelRmsMagnitude = v2 ? get16(in + 28) : 0;
+  bool v3 = in[0] >= 3;
+  sample.climatePeriodMs = v3 ? get16(in + 30) * 100u : 0;
+  sample.motionPeriodMs = v3 ? get16(in + 32) * 100u : 0;
+  return true;
+}
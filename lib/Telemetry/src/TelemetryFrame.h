@@ -0,0 +1,59 @@
+#pragma once
+
+// Compact binary sample published on sensor/frame: one MQTT packet per sample
+// cycle instead of five. Fixed size, little-endian; bump
+// TELEMETRY_FRAME_VERSION whenever the layout changes and update the decoder
+// in mqtt_logger.js to match.
+//
+//  offset  size  field
+//       0     1  version
+//       1     1  flags (TelemetryFlags)
+//       2     2  sequence number, wraps at 65535
+//       4     4  device timestamp, millis()
+//       8     2  temperature, 0.01 C (int16)
+//      10     2  humidity, 0.01 %RH (uint16)
+//      12    12  AcX AcY AcZ GyX GyY GyZ, raw MPU6050 counts (int16)
+//      24     2  IMU samples in the report window (uint16)            v2
+//      26     2  peak |a| over the window, raw counts (uint16)        v2
+//      28     2  RMS |a| over the window, raw counts (uint16)         v2
+//      30     2  climate (DHT11) sampling period, 0.1 s (uint16)     v3
+//      32     2  motion report period, 0.1 s (uint16)                v3
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TELEMETRY_FRAME_VERSION 3
+#define TELEMETRY_FRAME_SIZE 34
+#define TELEMETRY_FRAME_V1_SIZE 24
+#define TELEMETRY_FRAME_V2_SIZE 30
+
+enum TelemetryFlags : uint8_t
+{
+  FRAME_MOTION_ALERT = 0x01,
+  FRAME_CLIMATE_ALERT = 0x02,
+  FRAME_DHT_VALID = 0x04,
+  FRAME_MPU_VALID = 0x08
+};
+
+struct TelemetrySample
+{
+  uint16_t seq;
+  uint32_t deviceMs;
+  uint8_t flags;
+  float temperature;
+  float humidity;
+  int16_t accel[3];
+  int16_t gyro[3];
+  uint16_t windowSamples;
+  uint16_t accelPeakMagnitude;
+  uint16_t accelRmsMagnitude;
+  uint32_t climatePeriodMs; // sampling periods when the frame was taken
+  uint32_t motionPeriodMs;
+};
+
+// Returns the number of bytes written, or 0 if capacity is too small.
+size_t encodeTelemetryFrame(const TelemetrySample &sample, uint8_t *out, size_t capacity);
+
+// Accepts v1 to v3 frames (fields a version lacks are left at 0). Returns
+// false on a short buffer or an unknown version.
+bool decodeTelemetryFrame(const uint8_t *in, size_t length, TelemetrySample &sample);
@@ -2,35 +2,252 @@ const mqtt = require('mqtt');
 const sqlite3 = require('sqlite3').verbose();
 const path = require('path');
 
-// MQTT broker URL (correct format with protocol)
-const brokerUrl = "mqtt://192.168.0.5";
+// MQTT broker URL (correct format with protocol); MQTT_URL overrides it, e.g.
+// for a load test against a local broker
+const brokerUrl = process.env.MQTT_URL || "mqtt://192.168.0.5";
 
-// Topics to subscribe
-const topics = [
+// Device topics, subscribed both bare (single board, DEVICE_TOPICS=0) and
+// under devices/<id>/ (the firmware default)
+const deviceTopics = [
+  "sensor/frame",
+  "sensor/frame/batch",
   "sensor/temperature",
   "sensor/humidity",
   "sensor/motion",
   "alert/climate",
   "alert/motion",
-  "alert/button"
+  "alert/button",
+  "status/wake",
+  "status/diagnostics"
 ];
+const topics = deviceTopics.concat(deviceTopics.map((topic) => `devices/+/${topic}`));
+
+// Rows are written in one transaction per flush: once FLUSH_ROWS are queued
+// or FLUSH_INTERVAL_MS after the first one, whichever comes first. A flush
+// takes whole messages, so a replayed batch never spans two transactions.
+const FLUSH_ROWS = 500;
+const FLUSH_INTERVAL_MS = 200;
+// After each flush a summary goes to this topic (the fleet load generator
+// measures end-to-end latency from it).
+const STATS_TOPIC = "logger/stats";
+const verbose = process.env.LOGGER_VERBOSE === "1";
 
 // Connect to MQTT broker
 const client = mqtt.connect(brokerUrl);
 
 // Connect to SQLite database (or create if not exists)
-const dbPath = path.join(__dirname, 'sensor_data.db');
+const dbPath = process.env.SENSOR_DB || path.join(__dirname, 'sensor_data.db');
 const db = new sqlite3.Database(dbPath);
 
-// Create table if not exists
-db.run(`
-  CREATE TABLE IF NOT EXISTS sensor_logs (
-    id INTEGER PRIMARY KEY AUTOINCREMENT,
-    topic TEXT NOT NULL,
-    payload TEXT NOT NULL,
-    timestamp DATETIME DEFAULT CURRENT_TIMESTAMP
-  )
-`);
+// Create table if not exists. topic is relative to the device; device is
+// NULL for boards publishing bare topics.
+db.serialize(() => {
+  db.run(`
+    CREATE TABLE IF NOT EXISTS sensor_logs (
+      id INTEGER PRIMARY KEY AUTOINCREMENT,
+      topic TEXT NOT NULL,
+      payload TEXT NOT NULL,
+      timestamp DATETIME DEFAULT CURRENT_TIMESTAMP,
+      device TEXT
+    )
+  `);
+  // tables created before device topics lack the column
+  db.all("PRAGMA table_info(sensor_logs)", (err, columns) => {
+    if (!err && !columns.some((column) => column.name === "device")) {
+      db.run("ALTER TABLE sensor_logs ADD COLUMN device TEXT");
+    }
+  });
+  // the API reads the newest rows, overall and per topic
+  db.run("CREATE INDEX IF NOT EXISTS idx_sensor_logs_timestamp ON sensor_logs (timestamp)");
+  db.run("CREATE INDEX IF NOT EXISTS idx_sensor_logs_topic_timestamp ON sensor_logs (topic, timestamp)");
+  db.run("PRAGMA journal_mode = WAL"); // the API reads while the logger writes
+});
+
+// Packed telemetry frame (see lib/Telemetry/src/TelemetryFrame.h)
+const FRAME_SIZES = { 1: 24, 2: 30, 3: 34 };
+
+const MAX_MISSING = 4096;
+
+// Sequence tracking per device ("" for bare topics).
+const devices = new Map();
+
+function deviceState(device) {
+  let state = devices.get(device);
+  if (!state) {
+    state = {
+      lastFrameSeq: null,
+      framesRecovered: 0,
+      // Sequence numbers skipped by live frames; journaled frames replayed
+      // after an outage fill them in, whatever is left is lost.
+      missingSeqs: new Set(),
+      // Wall clock minus device millis() of the latest live frame, used to
+      // date replayed frames. Frames journaled before a device reboot get
+      // dated with the new boot's offset.
+      clockOffset: null,
+    };
+    devices.set(device, state);
+  }
+  return state;
+}
+
+// Splits "devices/<id>/<topic>" into the device and its topic.
+function parseTopic(topic) {
+  if (topic.startsWith("devices/")) {
+    const slash = topic.indexOf("/", 8);
+    if (slash > 8) return { device: topic.slice(8, slash), topic: topic.slice(slash + 1) };
+  }
+  return { device: null, topic };
+}
+
+function decodeFrame(buf) {
+  const version = buf.length > 0 ? buf.readUInt8(0) : 0;
+  if (!FRAME_SIZES[version] || buf.length < FRAME_SIZES[version]) return null;
+  const flags = buf.readUInt8(1);
+  const frame = {
+    seq: buf.readUInt16LE(2),
+    device_ms: buf.readUInt32LE(4),
+    temperature: flags & 0x04 ? buf.readInt16LE(8) / 100 : null,
+    humidity: flags & 0x04 ? buf.readUInt16LE(10) / 100 : null,
+    AcX: flags & 0x08 ? buf.readInt16LE(12) : null,
+    AcY: flags & 0x08 ? buf.readInt16LE(14) : null,
+    AcZ: flags & 0x08 ? buf.readInt16LE(16) : null,
+    GyX: flags & 0x08 ? buf.readInt16LE(18) : null,
+    GyY: flags & 0x08 ? buf.readInt16LE(20) : null,
+    GyZ: flags & 0x08 ? buf.readInt16LE(22) : null,
+    motion_alert: flags & 0x01 ? 1 : 0,
+    climate_alert: flags & 0x02 ? 1 : 0,
+  };
+  if (version >= 2) {
+    frame.window_samples = buf.readUInt16LE(24);
+    frame.accel_peak = buf.readUInt16LE(26);
+    frame.accel_rms = buf.readUInt16LE(28);
+  }
+  if (version >= 3) {
+    // current sampling periods of the adaptive scheduler
+    frame.climate_period_s = buf.readUInt16LE(30) / 10;
+    frame.motion_period_s = buf.readUInt16LE(32) / 10;
+  }
+  return frame;
+}
+
+// Records frames missing between consecutive sequence numbers (16-bit wrap).
+function trackSequence(state, device, seq) {
+  if (state.lastFrameSeq !== null) {
+    const gap = (seq - state.lastFrameSeq - 1 + 0x10000) & 0xffff;
+    // a large jump backwards is a device reboot, not loss
+    if (gap > 0 && gap < 0x8000) {
+      for (let i = 1; i <= gap && state.missingSeqs.size < MAX_MISSING; i++) {
+        state.missingSeqs.add((state.lastFrameSeq + i) & 0xffff);
+      }
+      console.warn(
+        `[FRAME] ${device || "-"}: ${gap} frame(s) missing before seq ${seq} (${state.missingSeqs.size} outstanding)`
+      );
+    }
+  }
+  state.lastFrameSeq = seq;
+}
+
+function recoverSequence(state, seq) {
+  if (state.missingSeqs.delete(seq)) state.framesRecovered++;
+}
+
+function sqlTimestamp(ms) {
+  return new Date(ms).toISOString().replace("T", " ").slice(0, 19);
+}
+
+// Rows waiting for the next flush: [topic, payload, timestamp, device].
+let pending = [];
+// Frames in the pending rows, oldest and newest, for the stats message.
+let pendingFirstFrame = null;
+let pendingLastFrame = null;
+let flushTimer = null;
+let flushing = false;
+let rowsWritten = 0;
+let insertStmt = null;
+
+// Queues the rows of one message. They always go into the same flush, so a
+// replayed batch is committed in one transaction, never split between two.
+function queueRows(rows, frameRef) {
+  pending.push(...rows);
+  if (frameRef) {
+    if (!pendingFirstFrame) pendingFirstFrame = frameRef;
+    pendingLastFrame = frameRef;
+  }
+  if (pending.length >= FLUSH_ROWS) {
+    flush();
+  } else if (!flushTimer) {
+    flushTimer = setTimeout(flush, FLUSH_INTERVAL_MS);
+  }
+}
+
+// Writes the queued rows in one transaction. A flush that finds the previous
+// one still running leaves its rows queued for the next.
+function flush() {
+  if (flushTimer) {
+    clearTimeout(flushTimer);
+    flushTimer = null;
+  }
+  if (pending.length === 0) return;
+  if (flushing) {
+    flushTimer = setTimeout(flush, FLUSH_INTERVAL_MS);
+    return;
+  }
+
+  const rows = pending;
+  const first = pendingFirstFrame;
+  const last = pendingLastFrame;
+  pending = [];
+  pendingFirstFrame = pendingLastFrame = null;
+  flushing = true;
+  const started = Date.now();
+
+  if (!insertStmt) {
+    insertStmt = db.prepare(
+      "INSERT INTO sensor_logs (topic, payload, timestamp, device) VALUES (?, ?, COALESCE(?, CURRENT_TIMESTAMP), ?)"
+    );
+  }
+  db.serialize(() => {
+    db.run("BEGIN TRANSACTION");
+    rows.forEach((row) => insertStmt.run(row));
+    db.run("COMMIT", (err) => {
+      flushing = false;
+      if (err) {
+        console.error("DB batch insert error:", err.message);
+        return;
+      }
+      rowsWritten += rows.length;
+      client.publish(
+        STATS_TOPIC,
+        JSON.stringify({ rows: rows.length, total: rowsWritten, flush_ms: Date.now() - started, first, last })
+      );
+    });
+  });
+}
+
+// Queues every frame of a replayed batch, as one unit.
+function insertBatch(device, message) {
+  const size = FRAME_SIZES[message.length > 0 ? message.readUInt8(0) : 0];
+  if (!size || message.length % size !== 0) {
+    console.error(`[FRAME] Dropped undecodable batch (${message.length} bytes)`);
+    return;
+  }
+
+  const state = deviceState(device || "");
+  const rows = [];
+  for (let offset = 0; offset < message.length; offset += size) {
+    const frame = decodeFrame(message.subarray(offset, offset + size));
+    if (!frame) continue;
+    recoverSequence(state, frame.seq);
+    frame.replayed = 1;
+    const timestamp = state.clockOffset !== null ? sqlTimestamp(state.clockOffset + frame.device_ms) : null;
+    rows.push(["sensor/frame", JSON.stringify(frame), timestamp, device]);
+  }
+  if (rows.length > 0) queueRows(rows, null);
+  console.log(
+    `[FRAME] ${device || "-"}: replayed ${rows.length} frame(s); ${state.framesRecovered} recovered, ` +
+      `${state.missingSeqs.size} outstanding`
+  );
+}
 
 client.on("connect", () => {
   console.log("Connected to MQTT broker.");
@@ -43,22 +260,48 @@ client.on("connect", () => {
   });
 });
 
-client.on("message", (topic, message) => {
-  const payload = message.toString();
-  console.log(`[MQTT] ${topic} => ${payload}`);
+client.on("message", (fullTopic, message) => {
+  const { device, topic } = parseTopic(fullTopic);
+  if (topic === "sensor/frame/batch") {
+    insertBatch(device, message);
+    return;
+  }
 
-  db.run(
-    "INSERT INTO sensor_logs (topic, payload) VALUES (?, ?)",
-    [topic, payload],
-    (err) => {
-      if (err) console.error("DB insert error:", err.message);
+  let payload;
+  let frame = null;
+  if (topic === "sensor/frame") {
+    frame = decodeFrame(message);
+    if (!frame) {
+      console.error(`[FRAME] Dropped undecodable frame (${message.length} bytes)`);
+      return;
     }
-  );
+    const state = deviceState(device || "");
+    trackSequence(state, device, frame.seq);
+    state.clockOffset = Date.now() - frame.device_ms;
+    payload = JSON.stringify(frame);
+  } else {
+    payload = message.toString();
+  }
+  if (verbose) console.log(`[MQTT] ${fullTopic} => ${payload}`);
+
+  queueRows([[topic, payload, sqlTimestamp(Date.now()), device]], frame ? { device, seq: frame.seq } : null);
 });
 
+// Waits for a running flush, writes what is still queued, then closes.
+function shutdown() {
+  if (flushing) {
+    setTimeout(shutdown, 50);
+    return;
+  }
+  flush();
+  if (insertStmt) insertStmt.finalize();
+  db.close(() => {
+    client.end();
+    process.exit(0);
+  });
+}
+
 process.on("SIGINT", () => {
   console.log("\nClosing connections...");
-  client.end();
-  db.close();
-  process.exit(0);
+  shutdown();
 });
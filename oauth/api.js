@@ -13,8 +13,9 @@ app.use(cors());
 // Load RSA public key
 const publicKey = fs.readFileSync("public.pem");
 
-// Resolve correct path to the SQLite database (one folder above)
-const dbPath = path.join(__dirname, "..", "sensor_data.db");
+// Resolve correct path to the SQLite database (one folder above); SENSOR_DB
+// overrides it, as for the logger
+const dbPath = process.env.SENSOR_DB || path.join(__dirname, "..", "sensor_data.db");
 
 // Connect to SQLite database
 const db = new sqlite3.Database(dbPath, (err) => {
@@ -1,8 +1,120 @@
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_attr.h>
+#include <esp_sleep.h>
+#include <driver/rtc_io.h>
 #include <ArduinoJson.h>
 #include <Wire.h>
 #include <WiFi.h>
 #include <PubSubClient.h>
 #include <DHT.h>
+#include <Dht11Reader.h>
+#include <SampleCycle.h>
+#include <TelemetryFrame.h>
+#include <MotionFeatures.h>
+#include <Mpu6050Fifo.h>
+#include <Mpu6050Motion.h>
+#include <ReportPolicy.h>
+#include <ConnectionManager.h>
+#include <Preferences.h>
+#include <TelemetryJournal.h>
+#include <SpscRing.h>
+#include <MqttRouter.h>
+#include <Log.h>
+#include <StageStats.h>
+#include "TelemetryPolicy.h"
+
+// Acquisition and alert evaluation run in a task pinned to the app core,
+// MQTT/Wi-Fi in one pinned to the protocol core, so a slow TCP write never
+// delays a sample. DUAL_CORE_TASKS=0 runs both halves from loop() instead.
+#ifndef DUAL_CORE_TASKS
+#ifdef CONFIG_FREERTOS_UNICORE
+#define DUAL_CORE_TASKS 0
+#else
+#define DUAL_CORE_TASKS 1
+#endif
+#endif
+
+// Telemetry format: one packed frame per cycle on sensor/frame, and/or the
+// original per-value topics for existing consumers (Node-RED, web dashboard).
+#ifndef TELEMETRY_PACKED_FRAME
+#define TELEMETRY_PACKED_FRAME 1
+#endif
+#ifndef TELEMETRY_LEGACY_TOPICS
+#define TELEMETRY_LEGACY_TOPICS 0
+#endif
+
+// Per-device topics: the board publishes under devices/<mac>/ (sensor/frame
+// becomes devices/246f289a3c51/sensor/frame) and takes commands both there
+// and on the fleet-wide topic. DEVICE_TOPICS=0 keeps the bare topics of a
+// single-board setup.
+#ifndef DEVICE_TOPICS
+#define DEVICE_TOPICS 1
+#endif
+
+// Frames taken while offline go to a journal on the raw "journal" flash
+// partition (partitions.csv) and are replayed in rate-limited batches on
+// sensor/frame/batch after reconnecting.
+#ifndef TELEMETRY_JOURNAL
+#define TELEMETRY_JOURNAL TELEMETRY_PACKED_FRAME
+#endif
+
+// MPU6050 acquisition: the chip samples into its FIFO at MPU_SAMPLE_RATE_HZ
+// and every report summarises the whole window. MPU_FIFO_ACQUISITION=0 falls
+// back to one register snapshot per report.
+#ifndef MPU_FIFO_ACQUISITION
+#define MPU_FIFO_ACQUISITION 1
+#endif
+#ifndef MPU_SAMPLE_RATE_HZ
+#define MPU_SAMPLE_RATE_HZ 500
+#endif
+
+// DHT11 reads: the asynchronous reader times the start pulse across
+// acquisition steps and decodes the answer from interrupt timestamps.
+// DHT_ASYNC_READER=0 goes back to the Adafruit driver, which blocks the
+// acquisition task for ~23 ms per read.
+#ifndef DHT_ASYNC_READER
+#define DHT_ASYNC_READER 1
+#endif
+
+// Adaptive sampling (ADAPTIVE_SAMPLING, CLIMATE_PERIOD_*_MS,
+// MOTION_PERIOD_*_MS) is configured in TelemetryPolicy.h, which the fleet
+// load generator shares.
+
+// Hardware events instead of polling: the MPU6050 pulses its INT pin once its
+// high-pass filtered acceleration has stayed beyond MPU_MOTION_THRESHOLD_MG
+// for MPU_MOTION_DURATION_MS, and the button interrupts on its edges. The
+// ISRs only post the event to the acquisition task; motion closes the motion
+// window at once. MPU_MOTION_INTERRUPT=0 goes back to checking the FIFO
+// window on every drain, BUTTON_INTERRUPT=0 to reading the pin every step.
+#ifndef MPU_MOTION_INTERRUPT
+#define MPU_MOTION_INTERRUPT 1
+#endif
+#ifndef MPU_MOTION_THRESHOLD_MG
+#define MPU_MOTION_THRESHOLD_MG 120 // ~MOTION_ACTIVE_EXCESS
+#endif
+#ifndef MPU_MOTION_DURATION_MS
+#define MPU_MOTION_DURATION_MS 2
+#endif
+#ifndef BUTTON_INTERRUPT
+#define BUTTON_INTERRUPT 1
+#endif
+static_assert(MPU_MOTION_THRESHOLD_MG <= MPU_MOTION_THRESHOLD_MAX_MG && MPU_MOTION_DURATION_MS <= MPU_MOTION_DURATION_MAX_MS,
+              "MOT_THR/MOT_DUR out of range");
+
+// Stage timings and failure counters go out as one status/diagnostics
+// message per interval (0: never). Serial verbosity is set by LOG_LEVEL.
+#ifndef DIAGNOSTICS_INTERVAL_MS
+#define DIAGNOSTICS_INTERVAL_MS 60000
+#endif
+
+// The button puts the board into deep sleep and wakes it again (ext0). With
+// SLEEP_TIMER_WAKE_S > 0 it also wakes on a timer to check in: it samples for
+// a moment, sends a frame only if a channel is due and goes back to sleep.
+#ifndef SLEEP_TIMER_WAKE_S
+#define SLEEP_TIMER_WAKE_S 0
+#endif
 
 // Wi-Fi credentials
 const char *ssid = "NOWO-2018";
@@ -12,100 +124,299 @@ const char *password = "F79C510583554FE7";
 const char *mqtt_server = "192.168.0.5";
 WiFiClient espClient;
 PubSubClient client(espClient);
+ConnectionManager connection(espClient, client, ssid, password);
+char deviceTopicPrefix[24]; // "devices/<mac>", set in setup()
 
 // Pins and sensor type
 #define DHTPIN 14
 #define DHTTYPE DHT11
 #define LED_PIN 5
 #define BUTTON_PIN 4
+#define MPU_INT_PIN 27
 
+#if DHT_ASYNC_READER
+Dht11Reader dhtReader(DHTPIN);
+uint32_t dhtResultsUsed = 0; // dhtReader.results() at the last climate sample
+const unsigned long dhtLeadTime = 40; // start pulse + answer end before the sample cycle
+#else
 DHT dht(DHTPIN, DHTTYPE);
+#endif
 
 // MPU6050
 const int MPU_ADDR = 0x68;
 int16_t AcX, AcY, AcZ, GyX, GyY, GyZ;
+bool mpuValid = false;
+#if MPU_FIFO_ACQUISITION
+MotionWindow motionWindow; // gravity follows over ~256 FIFO samples
+#else
+MotionWindow motionWindow(1); // one snapshot per window
+#endif
+MotionFeatures motion;
 
-// Alert thresholds
-const float TEMP_MIN = 10.0;
-const float TEMP_MAX = 25.0;
-const float HUM_MAX = 80.0;
-const int MOTION_THRESHOLD = 18000;
-
-// State variables
-bool motionAlert = false;
-bool climateAlert = false;
-bool ledState = false;
-bool sleepMode = false;
-bool lastButtonState = HIGH;
+#if MPU_FIFO_ACQUISITION
+Mpu6050Fifo mpuFifo(Wire, MPU_ADDR);
+ImuRing imuRing;
+unsigned long lastFifoDrain = 0;
+const unsigned long fifoDrainInterval = 20; // the 1 KiB FIFO holds ~170 ms at 500 Hz
+#endif
+
+// Sampling schedule and alert evaluation, acquisition side (SampleCycle.h,
+// shared with the fleet load generator). The configuration, sampling and
+// report policies are in TelemetryPolicy.h. What the detectors learnt is
+// kept in RTC memory, so a wake from deep sleep scores its samples against
+// the history; only a cold boot starts afresh.
+static_assert(CLIMATE_SAMPLING.minMs >= DHT11_MIN_INTERVAL_MS, "the DHT11 needs 1 s between reads");
+RTC_DATA_ATTR DetectorState detectorState;
+SampleCycle sampling(CLIMATE_SAMPLING, MOTION_SAMPLING, detectorState);
+
+// Alert configuration, network side. The MQTT callback parses config/alerts
+// into alertConfig and hands a copy to the acquisition task. NVS is written
+// once a change has held for alertConfigSaveDelay: the retained fleet-wide
+// and device messages come back to back on every reconnect, and cost no
+// flash write unless together they changed something.
+AlertConfig alertConfig;
+AlertConfig savedAlertConfig; // what NVS holds
+SpscRing<AlertConfig, 4> alertConfigUpdates;
+bool alertConfigDirty = false;
+unsigned long alertConfigChangedAt = 0;
+const unsigned long alertConfigSaveDelay = 5000;
+bool alertConfigAckPending = false; // status/config goes out from networkStep()
+bool alertConfigAccepted = false;
+const char *const ALERT_CONFIG_NVS_NAMESPACE = "alerts";
+const char *const ALERT_CONFIG_NVS_KEY = "config.v1"; // bump with the AlertConfig layout
+
+ReportChannels legacyReport;
+ReportChannels frameReport;
+
+// Acquisition -> network hand-off: one record per sample cycle or button
+// press. The network task drains it every few ms; 15 records cover 15 s of a
+// stalled network task at the shortest motion period, and 1.5 s of motion
+// events 100 ms apart, before the acquisition side drops any.
+struct SampleRecord
+{
+  enum Kind : uint8_t
+  {
+    SAMPLE,
+    BUTTON
+  };
+  Kind kind;
+  bool sleepMode;         // BUTTON: true for a press (go to sleep), false when woken by one
+  TelemetrySample sample; // SAMPLE: seq is assigned when a frame goes out
+};
 
-unsigned long lastManualControl = 0;
+SpscRing<SampleRecord, 16> sampleQueue;
+size_t sampleQueueHighWater = 0;
+
+// ISR -> acquisition hand-off. Both handlers run from the GPIO interrupt of
+// the core that attached them and never preempt each other, so they are a
+// single producer. Sized for a bouncing contact between two task steps.
+struct InputEvent
+{
+  enum Kind : uint8_t
+  {
+    MOTION,
+    BUTTON_EDGE
+  } kind;
+  unsigned long ms; // BUTTON_EDGE: when the edge came in
+};
+
+SpscRing<InputEvent, 32> inputEvents;
+// A motion interrupt that came in too soon after the last record waits here
+// until the gap has passed; any record takes it with the window it closes.
+bool motionPending = false;
+
+#if DUAL_CORE_TASKS
+const BaseType_t ACQUISITION_CORE = 1; // APP_CPU
+const BaseType_t NETWORK_CORE = 0;     // PRO_CPU, next to the Wi-Fi stack
+const TickType_t acquisitionPeriod = pdMS_TO_TICKS(5);
+const TickType_t networkPeriod = pdMS_TO_TICKS(10);
+#endif
+
+// State variables. ledState and lastManualControl are written by the MQTT
+// callback on the network core and read by the acquisition task.
+std::atomic<bool> ledState{false};
+
+std::atomic<unsigned long> lastManualControl{0};
 const unsigned long overrideDuration = 10000; // 10 seconds
 
-unsigned long lastDebounceTime = 0;
 const unsigned long debounceDelay = 50;
+#if BUTTON_INTERRUPT
+volatile unsigned long lastButtonEdge = 0; // any edge, bounces included
+bool buttonSettling = false; // edges came in; the level is read once they stop
+unsigned long buttonEdgeMs = 0;
+bool buttonDown = false; // debounced level
+#else
+bool lastButtonState = HIGH;
+unsigned long lastDebounceTime = 0;
+unsigned long lastButtonLow = 0; // network side, for the sleep check
+#endif
+
+// Kept in RTC memory across deep sleep; zeroed on power-on.
+RTC_DATA_ATTR uint16_t frameSeq = 0;
+RTC_DATA_ATTR uint32_t wakeCount = 0;
+RTC_DATA_ATTR bool sleptLedState = false;
+RTC_DATA_ATTR ConnectionCache connectionCache;
+RTC_DATA_ATTR TelemetrySample lastFrame; // seeds the report deadbands after a timer wake
+RTC_DATA_ATTR bool haveLastFrame = false;
+RTC_DATA_ATTR uint32_t lastFrameAgeMs = 0; // at sleep entry
+
+// State of this boot. setup() resets it explicitly: the host bench reboots
+// without re-running the global initialisers.
+struct BootState
+{
+  esp_sleep_wakeup_cause_t wakeCause = ESP_SLEEP_WAKEUP_UNDEFINED;
+  bool checkIn = false; // timer wake: back to sleep once the frame is out
+  bool checkInSampleHandled = false;
+  bool networkStarted = false;
+  bool sleepPending = false;
+  bool wakeReported = false;
+};
+
+BootState boot;
+unsigned long lastFrameMs = 0;
+const unsigned long wakeSampleWindow = 250;     // IMU window for the first sample after a wake
+const unsigned long wakeConnectTimeout = 10000; // records wait this long for the broker after a wake
+const unsigned long checkInDeadline = 15000;    // a check-in never stays awake longer
 
-unsigned long lastSensorRead = 0;
-const unsigned long sensorInterval = 5000; // 5 seconds
+// Hot-path instrumentation: the acquisition task records i2c and dht, the
+// network task the rest.
+StageStats i2cStats;      // MPU6050 register read or FIFO drain
+StageStats dhtStats;      // DHT11 read or decode, once per transaction
+StageStats encodeStats;   // JSON serialisation and frame encoding
+StageStats publishStats;  // mqttPublish()
+StageStats mqttLoopStats; // client.loop()
+StageStats anomalyStats;  // alerts and anomaly scoring of one sample cycle
+std::atomic<uint32_t> dhtFailures{0};
+std::atomic<uint32_t> mpuFailures{0};
+std::atomic<uint32_t> motionInterrupts{0};
+uint32_t publishFailures = 0; // while the broker connection was up
+unsigned long lastDiagnostics = 0;
 
-void setup_wifi()
+#if TELEMETRY_JOURNAL
+TelemetryJournal journal; // replayed at the pace set in TelemetryPolicy.h
+unsigned long nextReplay = 0;
+bool livePublished = false;
+#endif
+
+void onLedCommand(const uint8_t *payload, size_t length)
 {
-  Serial.print("Connecting to Wi-Fi...");
-  WiFi.begin(ssid, password);
-  while (WiFi.status() != WL_CONNECTED)
+  if (payloadEquals(payload, length, "1"))
   {
-    delay(500);
-    Serial.print(".");
+    ledState = true;
   }
-  Serial.println("\nWi-Fi connected.");
-  Serial.print("ESP32 IP address: ");
-  Serial.println(WiFi.localIP());
+  else if (payloadEquals(payload, length, "0"))
+  {
+    ledState = false;
+  }
+  lastManualControl = millis(); // mark time of manual override
 }
 
-void mqttCallback(char *topic, byte *message, unsigned int length)
+// Reads the keys present in one channel of a config/alerts message over
+// policy. min_std is in the message's units (C, %RH, mg) and scaled by
+// countsPerUnit. False if a value is out of range.
+bool parseAnomalyPolicy(JsonVariantConst channel, float countsPerUnit, AnomalyPolicy &policy)
 {
-  String msg;
-  for (int i = 0; i < length; i++)
-  {
-    msg += (char)message[i];
-  }
+  float z = channel["z"] | policy.zEnterX10 / 10.0f;
+  float zClear = channel["z_clear"] | policy.zExitX10 / 10.0f;
+  float minStd = (channel["min_std"] | policy.minStd / countsPerUnit) * countsPerUnit;
+  // written so that NaN fails too
+  if (!(z >= 1.0f && z <= 100.0f && zClear >= 0.0f && zClear <= z && minStd >= 1.0f && minStd <= 100000.0f))
+    return false;
+  policy.zEnterX10 = (uint16_t)lroundf(z * 10);
+  policy.zExitX10 = (uint16_t)lroundf(zClear * 10);
+  policy.minStd = lroundf(minStd);
+  return true;
+}
 
-  Serial.printf("[MQTT] Message received on topic %s: %s\n", topic, msg.c_str());
+// config/alerts carries only the keys to change, e.g.
+// {"temp":{"max":27,"z":5},"motion":{"min_std":30}}. A message with any
+// value out of range changes nothing.
+bool parseAlertConfig(const uint8_t *payload, size_t length, AlertConfig &config)
+{
+  StaticJsonDocument<512> json;
+  if (deserializeJson(json, payload, length))
+    return false;
+  JsonObjectConst root = json.as<JsonObjectConst>();
+  if (root.isNull())
+    return false;
+  AlertConfig next = config;
+  JsonVariantConst temp = root["temp"];
+  JsonVariantConst hum = root["hum"];
+  next.tempMin = temp["min"] | next.tempMin;
+  next.tempMax = temp["max"] | next.tempMax;
+  next.humMax = hum["max"] | next.humMax;
+  if (!(next.tempMin < next.tempMax && next.humMax > 0.0f && next.humMax <= 100.0f))
+    return false;
+  if (!parseAnomalyPolicy(temp, 100.0f, next.temp) || !parseAnomalyPolicy(hum, 100.0f, next.hum) ||
+      !parseAnomalyPolicy(root["motion"], COUNTS_PER_MG, next.motion))
+    return false;
+  config = next;
+  return true;
+}
 
-  if (String(topic) == "actuator/led")
+void onAlertConfig(const uint8_t *payload, size_t length)
+{
+  AlertConfig config = alertConfig;
+  alertConfigAccepted = parseAlertConfig(payload, length, config);
+  alertConfigAckPending = true; // publishing from inside the callback would clobber the client's buffer
+  if (!alertConfigAccepted)
   {
-    if (msg == "1")
-    {
-      ledState = true;
-    }
-    else if (msg == "0")
-    {
-      ledState = false;
-    }
-    lastManualControl = millis(); // mark time of manual override
+    LOG_WARN("[CONFIG] Alert config rejected\n");
+    return;
   }
+  if (config == alertConfig)
+    return;
+  if (!alertConfigUpdates.push(config))
+  {
+    LOG_WARN("[CONFIG] Alert config dropped, acquisition side busy\n");
+    alertConfigAccepted = false;
+    return;
+  }
+  alertConfig = config;
+  alertConfigDirty = true;
+  alertConfigChangedAt = millis();
+  LOG_INFO("[CONFIG] Alert config updated\n");
+}
+
+// Subscribed topics; matched by hash without building a String.
+const MqttRoute mqttRoutes[] = {
+    MQTT_ROUTE("actuator/led", onLedCommand),
+    MQTT_ROUTE("config/alerts", onAlertConfig),
+};
+const size_t mqttRouteCount = sizeof(mqttRoutes) / sizeof(mqttRoutes[0]);
+
+void mqttCallback(char *topic, byte *message, unsigned int length)
+{
+  // payload capped so the line fits Serial.printf's stack buffer
+  LOG_DEBUG("[MQTT] Message received on topic %s: %.*s\n", topic, (int)(length < 8 ? length : 8),
+            (const char *)message);
+#if DEVICE_TOPICS
+  // routes are matched on the topic relative to this device
+  const char *own = topicUnder(topic, deviceTopicPrefix);
+  if (own)
+    topic = (char *)own;
+#endif
+  dispatchMqtt(mqttRoutes, mqttRouteCount, topic, message, length);
 }
 
-void reconnect()
+void onMqttConnected()
 {
-  while (!client.connected())
+  for (size_t i = 0; i < mqttRouteCount; i++)
   {
-    Serial.print("Connecting to MQTT...");
-    String clientId = "ESP32Client-";
-    clientId += String(random(0xffff), HEX);
-    if (client.connect(clientId.c_str()))
-    {
-      Serial.println("connected");
-      client.subscribe("actuator/led");
-      Serial.println("Subscribed to actuator/led");
-    }
-    else
+    client.subscribe(mqttRoutes[i].topic);
+    LOG_INFO("Subscribed to %s\n", mqttRoutes[i].topic);
+#if DEVICE_TOPICS
+    char topic[64];
+    if (joinTopic(topic, sizeof(topic), deviceTopicPrefix, mqttRoutes[i].topic))
     {
-      Serial.print("failed, rc=");
-      Serial.print(client.state());
-      Serial.println(". Retrying in 5s...");
-      delay(5000);
+      client.subscribe(topic);
+      LOG_INFO("Subscribed to %s\n", topic);
     }
+#endif
   }
+#if TELEMETRY_JOURNAL
+  nextReplay = boot.checkIn ? millis() : millis() + random(REPLAY_START_JITTER_MS); // a check-in has no time to wait
+#endif
 }
 
 void setup_mpu()
@@ -116,14 +427,27 @@ void setup_mpu()
   Wire.write(0x6B);
   Wire.write(0);
   Wire.endTransmission(true);
+
+#if MPU_FIFO_ACQUISITION
+  Wire.setClock(400000);
+  if (!mpuFifo.begin(MPU_SAMPLE_RATE_HZ))
+    LOG_ERROR("Failed to configure MPU6050 FIFO!\n");
+#endif
+#if MPU_MOTION_INTERRUPT
+  if (!enableMpuMotionInterrupt(Wire, MPU_ADDR, MPU_MOTION_THRESHOLD_MG, MPU_MOTION_DURATION_MS))
+    LOG_ERROR("Failed to enable MPU6050 motion interrupt!\n");
+#endif
 }
 
 void read_mpu()
 {
-  Wire.beginTransmission(MPU_ADDR);
-  Wire.write(0x3B);
-  Wire.endTransmission(false);
-  Wire.requestFrom((uint8_t)MPU_ADDR, (size_t)14, (bool)true);
+  {
+    StageTimer timer(i2cStats);
+    Wire.beginTransmission(MPU_ADDR);
+    Wire.write(0x3B);
+    Wire.endTransmission(false);
+    Wire.requestFrom((uint8_t)MPU_ADDR, (size_t)14, (bool)true);
+  }
 
   if (Wire.available() >= 14)
   {
@@ -135,14 +459,94 @@ void read_mpu()
     GyX = Wire.read() << 8 | Wire.read();
     GyY = Wire.read() << 8 | Wire.read();
     GyZ = Wire.read() << 8 | Wire.read();
+    mpuValid = true;
+    ImuSample sample = {{AcX, AcY, AcZ}, {GyX, GyY, GyZ}};
+    motionWindow.add(sample);
+  }
+  else
+  {
+    LOG_WARN("Failed to read from MPU6050!\n");
+    AcX = AcY = AcZ = GyX = GyY = GyZ = -9999;
+    mpuValid = false;
+  }
+}
+
+#if MPU_FIFO_ACQUISITION
+void drainMpuFifo()
+{
+  {
+    StageTimer timer(i2cStats);
+    mpuFifo.drain(imuRing);
+  }
+  ImuSample sample;
+  while (imuRing.pop(sample))
+    motionWindow.add(sample);
+}
+#endif
+
+// Closes the current motion window; AcX..GyZ keep the latest sample.
+void finishMotionWindow()
+{
+#if MPU_FIFO_ACQUISITION
+  drainMpuFifo();
+#else
+  read_mpu();
+#endif
+  motionWindow.finish(motion);
+  mpuValid = motion.samples > 0;
+#if MPU_FIFO_ACQUISITION
+  if (mpuValid)
+  {
+    AcX = motion.last.accel[0];
+    AcY = motion.last.accel[1];
+    AcZ = motion.last.accel[2];
+    GyX = motion.last.gyro[0];
+    GyY = motion.last.gyro[1];
+    GyZ = motion.last.gyro[2];
   }
   else
   {
-    Serial.println("Failed to read from MPU6050!");
+    LOG_WARN("Failed to read from MPU6050!\n");
     AcX = AcY = AcZ = GyX = GyY = GyZ = -9999;
   }
+#endif
 }
 
+// The network task announces it and puts the board to sleep.
+void buttonPressed()
+{
+  digitalWrite(LED_PIN, LOW);
+  ledState = false;
+
+  SampleRecord record = {};
+  record.kind = SampleRecord::BUTTON;
+  record.sleepMode = true;
+  sampleQueue.push(record);
+}
+
+#if BUTTON_INTERRUPT
+// The ISR only timestamps edges; the level it would read on the first edge
+// of a bounce may already be the wrong one. See checkButtonEdges().
+void IRAM_ATTR onButtonEdge()
+{
+  unsigned long now = millis();
+  lastButtonEdge = now;
+  inputEvents.push({InputEvent::BUTTON_EDGE, now});
+}
+
+// A bounce is a burst of edges a few ms apart: the contact has settled once
+// debounceDelay passed without one, and a press is a settled HIGH -> LOW.
+void checkButtonEdges()
+{
+  if (!buttonSettling || millis() - buttonEdgeMs < debounceDelay)
+    return;
+  buttonSettling = false;
+  bool down = digitalRead(BUTTON_PIN) == LOW;
+  if (down && !buttonDown)
+    buttonPressed();
+  buttonDown = down;
+}
+#else
 void checkButton()
 {
   bool currentState = digitalRead(BUTTON_PIN);
@@ -150,112 +554,730 @@ void checkButton()
 
   if (currentState != lastButtonState && currentState == LOW && (now - lastDebounceTime > debounceDelay))
   {
-    sleepMode = !sleepMode;
+    buttonPressed();
+    lastDebounceTime = now;
+  }
+
+  lastButtonState = currentState;
+}
+#endif
+
+#if MPU_MOTION_INTERRUPT
+void IRAM_ATTR onMotionInterrupt() { inputEvents.push({InputEvent::MOTION, 0}); }
+#endif
+
+// Acquisition side (app core): button, IMU, DHT and alerts. Never touches
+// the network.
+
+// Only setup() calls this; config/alerts changes come through
+// alertConfigUpdates.
+bool loadAlertConfig(AlertConfig &config)
+{
+  Preferences prefs;
+  if (!prefs.begin(ALERT_CONFIG_NVS_NAMESPACE, true))
+    return false; // nothing saved yet
+  AlertConfig stored;
+  bool ok = prefs.getBytesLength(ALERT_CONFIG_NVS_KEY) == sizeof(stored) &&
+            prefs.getBytes(ALERT_CONFIG_NVS_KEY, &stored, sizeof(stored)) == sizeof(stored);
+  prefs.end();
+  if (ok)
+    config = stored;
+  return ok;
+}
+
+// Boot: the saved configuration (or the defaults). The detectors keep their
+// history; setup() clears it on a cold boot.
+void resetAlerts()
+{
+  alertConfig = DEFAULT_ALERT_CONFIG;
+  if (loadAlertConfig(alertConfig))
+    LOG_INFO("[CONFIG] Alert config loaded from NVS\n");
+  savedAlertConfig = alertConfig;
+  alertConfigDirty = false;
+  alertConfigAckPending = false;
+  AlertConfig stale;
+  while (alertConfigUpdates.pop(stale))
+  {
+  }
+  sampling.applyConfig(alertConfig);
+}
 
-    if (sleepMode)
+// Reads the DHT if climateDue, closes the motion window, evaluates the alerts,
+// drives the LED and adapts both sampling periods, then queues the record for
+// the network side.
+void sampleCycle(unsigned long now, bool climateDue)
+{
+  AlertConfig config;
+  while (alertConfigUpdates.pop(config))
+    sampling.applyConfig(config);
+  motionPending = false;
+  float temp = NAN, hum = NAN;
+  if (climateDue)
+  {
+#if DHT_ASYNC_READER
+    // from the transaction that finished during the last few steps; with no
+    // new one since the last climate sample, the read has failed
+    if (dhtReader.results() != dhtResultsUsed)
     {
-      Serial.println("[BUTTON] Sleep Mode activated");
-      digitalWrite(LED_PIN, LOW);
-      ledState = false;
-      client.publish("alert/button", "Sleep Mode activated");
+      dhtResultsUsed = dhtReader.results();
+      temp = dhtReader.temperature();
+      hum = dhtReader.humidity();
     }
-    else
+#else
     {
-      Serial.println("[BUTTON] Sleep Mode deactivated");
-      client.publish("alert/button", "Sleep Mode deactivated");
+      StageTimer timer(dhtStats);
+      temp = dht.readTemperature();
+      hum = dht.readHumidity();
     }
+#endif
+    if (isnan(temp) || isnan(hum))
+      dhtFailures.fetch_add(1, std::memory_order_relaxed);
+  }
+  finishMotionWindow();
+  if (!mpuValid)
+    mpuFailures.fetch_add(1, std::memory_order_relaxed);
 
-    lastDebounceTime = now;
+  SampleRecord record = {};
+  record.kind = SampleRecord::SAMPLE;
+  TelemetrySample &sample = record.sample;
+  {
+    StageTimer timer(anomalyStats);
+    sampling.update(now, climateDue, temp, hum, motion, sample);
   }
 
-  lastButtonState = currentState;
+  bool override = (millis() - lastManualControl < overrideDuration);
+  digitalWrite(LED_PIN, override ? ledState.load() : (motionAlertOf(sample) || climateAlertOf(sample)));
+
+  sample.accel[0] = AcX;
+  sample.accel[1] = AcY;
+  sample.accel[2] = AcZ;
+  sample.gyro[0] = GyX;
+  sample.gyro[1] = GyY;
+  sample.gyro[2] = GyZ;
+  sampleQueue.push(record);
+}
+
+void acquisitionStep()
+{
+#if !BUTTON_INTERRUPT
+  checkButton(); // Check button every cycle
+#endif
+  InputEvent event;
+  while (inputEvents.pop(event))
+  {
+#if BUTTON_INTERRUPT
+    if (event.kind == InputEvent::BUTTON_EDGE)
+    {
+      buttonSettling = true;
+      buttonEdgeMs = event.ms;
+      continue;
+    }
+#endif
+    motionPending = true;
+    motionInterrupts.fetch_add(1, std::memory_order_relaxed);
+  }
+
+#if BUTTON_INTERRUPT
+  checkButtonEdges();
+#endif
+
+  // Motion that starts during a long quiet period is reported at once
+  // rather than at the end of the period.
+  bool motionBurst = motionPending && sampling.motionEventAllowed(millis());
+#if MPU_FIFO_ACQUISITION
+  if (millis() - lastFifoDrain >= fifoDrainInterval)
+  {
+    lastFifoDrain = millis();
+    drainMpuFifo();
+#if !MPU_MOTION_INTERRUPT
+    motionBurst = sampling.motionBurst(motionWindow.peakExcess());
+#endif
+  }
+#endif
+
+  unsigned long now = millis();
+#if DHT_ASYNC_READER
+  if (sampling.climateDue(now + dhtLeadTime))
+    dhtReader.start(); // no-op while a transaction is running or too recent
+  bool dhtDone;
+  {
+    // the poll that ends a transaction and decodes it; the others only
+    // check the clock
+    StageTimer timer(dhtStats);
+    dhtDone = dhtReader.poll();
+    if (!dhtDone)
+      timer.discard();
+  }
+  if (dhtDone && dhtReader.status() != DHT11_OK)
+    LOG_WARN("DHT11 read failed: %s\n", dht11StatusName(dhtReader.status()));
+#endif
+
+  bool climateDue = sampling.climateDue(now);
+#if DHT_ASYNC_READER
+  // the transaction started for this reading is still running: the record
+  // waits the few ms until it has finished
+  if (climateDue && dhtReader.busy())
+    return;
+#endif
+  if (climateDue || motionBurst || sampling.motionDue(now))
+    sampleCycle(now, climateDue);
+}
+
+// Network side (protocol core): MQTT, journal and the Serial report, fed
+// from sampleQueue.
+
+// Every publish goes through here to be timed. Failures only count while
+// the broker is up; offline publishes are expected to fail.
+bool publishTopic(const char *topic, const uint8_t *payload, size_t length)
+{
+  if (!client.connected())
+    return false;
+  bool sent;
+  {
+    StageTimer timer(publishStats);
+    sent = client.publish(topic, payload, length);
+  }
+  if (!sent)
+    publishFailures++;
+  return sent;
+}
+
+// With DEVICE_TOPICS, moved under the device's prefix.
+bool mqttPublish(const char *topic, const uint8_t *payload, size_t length)
+{
+#if DEVICE_TOPICS
+  char deviceTopic[64];
+  if (!joinTopic(deviceTopic, sizeof(deviceTopic), deviceTopicPrefix, topic))
+    return false;
+  topic = deviceTopic;
+#endif
+  return publishTopic(topic, payload, length);
+}
+
+bool mqttPublish(const char *topic, const char *payload)
+{
+  return mqttPublish(topic, (const uint8_t *)payload, strlen(payload));
+}
+
+// The original per-value topics and alert/button keep their bare names
+// whatever DEVICE_TOPICS says: they exist for the web dashboard, which
+// subscribes to exactly those.
+bool legacyPublish(const char *topic, const char *payload)
+{
+  return publishTopic(topic, (const uint8_t *)payload, strlen(payload));
 }
 
 void publishSensorData(float temp, float hum)
 {
-  client.publish("sensor/temperature", String(temp).c_str());
-  client.publish("sensor/humidity", String(hum).c_str());
+  unsigned long now = millis();
+  char text[16];
+  if (legacyReport.temp.due(temp, now) && formatCenti(text, sizeof(text), temp) &&
+      legacyPublish("sensor/temperature", text))
+    legacyReport.temp.published(temp, now);
+  if (legacyReport.hum.due(hum, now) && formatCenti(text, sizeof(text), hum) && legacyPublish("sensor/humidity", text))
+    legacyReport.hum.published(hum, now);
 }
 
-void publishMotionData()
+void publishMotionData(const TelemetrySample &sample)
 {
+  unsigned long now = millis();
+  float level = motionLevel(sample);
+  if (!legacyReport.motion.due(level, now))
+    return;
+
   StaticJsonDocument<256> json;
-  json["AcX"] = AcX;
-  json["AcY"] = AcY;
-  json["AcZ"] = AcZ;
-  json["GyX"] = GyX;
-  json["GyY"] = GyY;
-  json["GyZ"] = GyZ;
+  json["AcX"] = sample.accel[0];
+  json["AcY"] = sample.accel[1];
+  json["AcZ"] = sample.accel[2];
+  json["GyX"] = sample.gyro[0];
+  json["GyY"] = sample.gyro[1];
+  json["GyZ"] = sample.gyro[2];
+  json["samples"] = sample.windowSamples;
+  json["peak"] = sample.accelPeakMagnitude;
+  json["rms"] = sample.accelRmsMagnitude;
   char buffer[256];
-  serializeJson(json, buffer);
-  client.publish("sensor/motion", buffer);
+  {
+    StageTimer timer(encodeStats);
+    serializeJson(json, buffer);
+  }
+  if (legacyPublish("sensor/motion", buffer))
+    legacyReport.motion.published(level, now);
 }
 
-void publishAlerts()
+void publishAlerts(const TelemetrySample &sample)
 {
-  client.publish("alert/motion", motionAlert ? "1" : "0");
-  client.publish("alert/climate", climateAlert ? "1" : "0");
+  unsigned long now = millis();
+  bool motionAlert = motionAlertOf(sample);
+  bool climateAlert = climateAlertOf(sample);
+  if (legacyReport.motionAlert.due(motionAlert, now) && legacyPublish("alert/motion", motionAlert ? "1" : "0"))
+    legacyReport.motionAlert.published(motionAlert, now);
+  if (legacyReport.climateAlert.due(climateAlert, now) && legacyPublish("alert/climate", climateAlert ? "1" : "0"))
+    legacyReport.climateAlert.published(climateAlert, now);
 }
 
-void setup()
+bool frameDue(const TelemetrySample &sample) { return frameReport.frameDue(sample, millis()); }
+
+// Restarts the deadbands and heartbeats from this frame. atMs may lie before
+// this boot: after a timer wake the channels are seeded from RTC memory.
+void markFrameReported(const TelemetrySample &sample, unsigned long atMs)
 {
-  Serial.begin(115200);
-  pinMode(LED_PIN, OUTPUT);
-  pinMode(BUTTON_PIN, INPUT_PULLUP);
-  dht.begin();
-  setup_wifi();
-  setup_mpu();
-  client.setServer(mqtt_server, 1883);
-  client.setCallback(mqttCallback);
+  frameReport.framePublished(sample, atMs);
+  lastFrame = sample;
+  haveLastFrame = true;
+  lastFrameMs = atMs;
 }
 
-void loop()
+// First frame delivered after a wake: reports how long that took from reset.
+void reportWake()
 {
-  if (!client.connected())
-    reconnect();
-  client.loop();
+  if (boot.wakeCause == ESP_SLEEP_WAKEUP_UNDEFINED || boot.wakeReported)
+    return;
+  boot.wakeReported = true;
+  unsigned long latency = millis();
+  const char *cause = boot.wakeCause == ESP_SLEEP_WAKEUP_TIMER ? "timer" : "button";
+  LOG_INFO("[WAKE] First frame %lu ms after %s wake\n", latency, cause);
+  char json[80];
+  snprintf(json, sizeof(json), "{\"cause\":\"%s\",\"latency_ms\":%lu,\"wakes\":%lu}", cause, latency,
+           (unsigned long)wakeCount);
+  mqttPublish("status/wake", json);
+}
 
-  checkButton(); // Check button every cycle
+void publishFrame(TelemetrySample sample)
+{
+  if (!frameDue(sample))
+    return;
 
-  if (sleepMode)
+  sample.seq = frameSeq++;
+  uint8_t frame[TELEMETRY_FRAME_SIZE];
+  size_t length;
   {
-    Serial.println("[SLEEP MODE] System is paused.");
-    digitalWrite(LED_PIN, LOW);
-    return; // Skip everything else
+    StageTimer timer(encodeStats);
+    length = encodeTelemetryFrame(sample, frame, sizeof(frame));
   }
+  bool sent = connection.connected() && mqttPublish("sensor/frame", frame, length);
+  if (sent)
+    reportWake();
+#if TELEMETRY_JOURNAL
+  if (sent)
+    livePublished = true;
+  else
+    sent = journal.append(frame);
+#endif
+  if (sent)
+    markFrameReported(sample, millis());
+}
 
-  unsigned long now = millis();
-  if (now - lastSensorRead >= sensorInterval)
+#if TELEMETRY_JOURNAL
+// Sends one batch of journaled frames. Live frames go first: nothing is
+// replayed in a network step that already published a live frame.
+void replayJournal()
+{
+  if (livePublished || journal.pending() == 0 || (long)(millis() - nextReplay) < 0)
+    return;
+
+  uint8_t batch[REPLAY_BATCH_FRAMES * TELEMETRY_FRAME_SIZE];
+  size_t frames = journal.readBatch(batch, REPLAY_BATCH_FRAMES);
+  if (frames == 0 || mqttPublish("sensor/frame/batch", batch, frames * TELEMETRY_FRAME_SIZE))
   {
-    lastSensorRead = now;
+    journal.commitBatch();
+    if (frames > 0)
+      reportWake();
+  }
+  nextReplay = millis() + REPLAY_INTERVAL_MS;
+}
+#endif
+
+// The per-cycle Serial dump; compiled in with LOG_LEVEL_DEBUG only.
+void logSample(const TelemetrySample &sample)
+{
+  Serial.println("===== SENSOR STATUS =====");
+  if (dhtValid(sample))
+  {
+    char text[16];
+    formatCenti(text, sizeof(text), sample.temperature);
+    Serial.printf("Temperature: %s °C\n", text);
+    formatCenti(text, sizeof(text), sample.humidity);
+    Serial.printf("Humidity: %s %%\n", text);
+  }
+  else
+  {
+    Serial.println("DHT sensor read failed!");
+  }
+
+  Serial.printf("Accel: X=%d Y=%d Z=%d\n", sample.accel[0], sample.accel[1], sample.accel[2]);
+  Serial.printf("Gyro: X=%d Y=%d Z=%d\n", sample.gyro[0], sample.gyro[1], sample.gyro[2]);
+  Serial.printf("Motion window: %u samples, |a| peak=%u rms=%u\n", sample.windowSamples,
+                sample.accelPeakMagnitude, sample.accelRmsMagnitude);
+  Serial.printf("Sampling: climate every %lu ms, motion every %lu ms\n", (unsigned long)sample.climatePeriodMs,
+                (unsigned long)sample.motionPeriodMs);
+  Serial.printf("LED Remote State: %s\n", ledState ? "ON" : "OFF");
+  Serial.printf("Sample queue: %u queued, high water %u/%u, %u dropped\n", (unsigned)sampleQueue.size(),
+                (unsigned)sampleQueueHighWater, (unsigned)sampleQueue.capacity(), (unsigned)sampleQueue.drops());
+  Serial.printf("Heap: %u free, %u min free, %u largest block\n", (unsigned)ESP.getFreeHeap(),
+                (unsigned)ESP.getMinFreeHeap(), (unsigned)ESP.getMaxAllocHeap());
+  Serial.println("=========================\n");
+}
+
+void reportSample(const TelemetrySample &sample)
+{
+  if (LOG_ENABLED(LOG_LEVEL_DEBUG))
+    logSample(sample);
+#if TELEMETRY_LEGACY_TOPICS
+  if (dhtValid(sample))
+    publishSensorData(sample.temperature, sample.humidity);
+  publishMotionData(sample);
+  publishAlerts(sample);
+#if !TELEMETRY_PACKED_FRAME
+  if (connection.connected())
+    reportWake();
+#endif
+#endif
+#if TELEMETRY_PACKED_FRAME
+  publishFrame(sample);
+#endif
+}
+
+// One compact status/diagnostics message per DIAGNOSTICS_INTERVAL_MS: the
+// counters since boot, then per stage [count,maxUs,buckets...] for the
+// interval (see StageStats.h for the buckets).
+void publishDiagnostics()
+{
+  lastDiagnostics = millis();
+  char json[480];
+  size_t length = snprintf(json, sizeof(json),
+                           "{\"up_s\":%lu,\"reconnects\":%lu,\"dht_fail\":%lu,\"mpu_fail\":%lu,\"pub_fail\":%lu,"
+                           "\"motion_irq\":%lu,\"drops\":%lu,\"heap_min\":%lu,\"stages\":{",
+                           millis() / 1000, (unsigned long)connection.reconnects(), (unsigned long)dhtFailures.load(),
+                           (unsigned long)mpuFailures.load(), (unsigned long)publishFailures,
+                           (unsigned long)motionInterrupts.load(),
+                           (unsigned long)sampleQueue.drops(), (unsigned long)ESP.getMinFreeHeap());
+  struct
+  {
+    const char *name;
+    StageStats &stats;
+  } stages[] = {{"i2c", i2cStats}, {"dht", dhtStats}, {"anomaly", anomalyStats},
+                 {"encode", encodeStats}, {"publish", publishStats}, {"mqtt_loop", mqttLoopStats}};
+  bool first = true;
+  for (size_t i = 0; i < sizeof(stages) / sizeof(stages[0]); i++)
+  {
+    // a stage that does not fit is left out rather than truncating the message
+    size_t start = first ? length : length + 1;
+    if (start >= sizeof(json) - 2)
+      break;
+    size_t n = stages[i].stats.appendWindow(json + start, sizeof(json) - 2 - start, stages[i].name);
+    if (n == 0)
+      continue;
+    if (!first)
+      json[length] = ',';
+    length = start + n;
+    first = false;
+  }
+  json[length++] = '}';
+  json[length++] = '}';
+  json[length] = '\0';
+  mqttPublish("status/diagnostics", (const uint8_t *)json, length);
+}
 
-    float temp = dht.readTemperature();
-    float hum = dht.readHumidity();
-    read_mpu();
+// Rounded for the ack, so 0.3 C reads 0.3 and not 0.300000012.
+double tenths(double value) { return round(value * 10) / 10; }
 
-    motionAlert = abs(AcX) > MOTION_THRESHOLD || abs(AcY) > MOTION_THRESHOLD || abs(AcZ) > MOTION_THRESHOLD;
-    climateAlert = (temp < TEMP_MIN || temp > TEMP_MAX || hum > HUM_MAX);
+void addAnomalyPolicy(JsonObject channel, double countsPerUnit, const AnomalyPolicy &policy)
+{
+  channel["z"] = policy.zEnterX10 / 10.0;
+  channel["z_clear"] = policy.zExitX10 / 10.0;
+  channel["min_std"] = round(policy.minStd / countsPerUnit * 100) / 100;
+}
 
-    bool override = (millis() - lastManualControl < overrideDuration);
-    digitalWrite(LED_PIN, override ? ledState : (motionAlert || climateAlert));
+// status/config: the configuration in effect after a config/alerts message,
+// and whether that message was accepted.
+void publishAlertConfig()
+{
+  alertConfigAckPending = false;
+  StaticJsonDocument<384> json;
+  json["accepted"] = alertConfigAccepted;
+  JsonObject temp = json.createNestedObject("temp");
+  temp["min"] = tenths(alertConfig.tempMin);
+  temp["max"] = tenths(alertConfig.tempMax);
+  addAnomalyPolicy(temp, 100, alertConfig.temp);
+  JsonObject hum = json.createNestedObject("hum");
+  hum["max"] = tenths(alertConfig.humMax);
+  addAnomalyPolicy(hum, 100, alertConfig.hum);
+  addAnomalyPolicy(json.createNestedObject("motion"), COUNTS_PER_MG, alertConfig.motion);
+  char buffer[320];
+  size_t length;
+  {
+    StageTimer timer(encodeStats);
+    length = serializeJson(json, buffer);
+  }
+  mqttPublish("status/config", (const uint8_t *)buffer, length);
+}
 
-    Serial.println("===== SENSOR STATUS =====");
-    if (!isnan(temp) && !isnan(hum))
+// Once a change has held for alertConfigSaveDelay, and before deep sleep.
+void saveAlertConfig()
+{
+  alertConfigDirty = false;
+  if (alertConfig == savedAlertConfig)
+    return; // changed and changed back
+  Preferences prefs;
+  if (prefs.begin(ALERT_CONFIG_NVS_NAMESPACE, false) &&
+      prefs.putBytes(ALERT_CONFIG_NVS_KEY, &alertConfig, sizeof(alertConfig)) == sizeof(alertConfig))
+  {
+    savedAlertConfig = alertConfig;
+    LOG_INFO("[CONFIG] Alert config saved to NVS\n");
+  }
+  else
+  {
+    LOG_ERROR("Failed to save alert config!\n");
+  }
+  prefs.end();
+}
+
+void handleRecord(const SampleRecord &record)
+{
+  if (record.kind == SampleRecord::BUTTON)
+  {
+    // a press during a timer check-in wakes the board for good
+    bool sleep = record.sleepMode && !boot.checkIn;
+    boot.checkIn = false;
+    boot.sleepPending = sleep;
+    const char *status = sleep ? "Sleep Mode activated" : "Sleep Mode deactivated";
+    LOG_INFO("[BUTTON] %s\n", status);
+    legacyPublish("alert/button", status);
+    return;
+  }
+  reportSample(record.sample);
+  if (boot.checkIn)
+    boot.checkInSampleHandled = true;
+}
+
+void startNetwork()
+{
+  connection.begin();
+  boot.networkStarted = true;
+}
+
+// The button has been let go and stopped bouncing. ext0 wakes on LOW, so
+// going to sleep on a bounce of the release would wake the board at once.
+bool buttonReleased()
+{
+  unsigned long now = millis();
+#if BUTTON_INTERRUPT
+  return digitalRead(BUTTON_PIN) == HIGH && now - lastButtonEdge >= debounceDelay;
+#else
+  if (digitalRead(BUTTON_PIN) == LOW)
+    lastButtonLow = now;
+  return now - lastButtonLow >= debounceDelay;
+#endif
+}
+
+// ext0 wakes on a level, so the board only goes to sleep once the button is
+// released. setup() runs again on wake.
+void enterDeepSleep()
+{
+  boot.sleepPending = false;
+  if (alertConfigDirty)
+    saveAlertConfig();
+  sleptLedState = ledState;
+  connectionCache = connection.cache();
+  lastFrameAgeMs = millis() - lastFrameMs;
+  if (connection.connected())
+    client.disconnect();
+  WiFi.disconnect(true);
+  LOG_INFO("[SLEEP] Entering deep sleep\n");
+  Serial.flush();
+
+  rtc_gpio_pullup_en((gpio_num_t)BUTTON_PIN); // INPUT_PULLUP does not hold in deep sleep
+  rtc_gpio_pulldown_dis((gpio_num_t)BUTTON_PIN);
+  esp_sleep_enable_ext0_wakeup((gpio_num_t)BUTTON_PIN, LOW);
+#if SLEEP_TIMER_WAKE_S > 0
+  esp_sleep_enable_timer_wakeup((uint64_t)SLEEP_TIMER_WAKE_S * 1000000ULL);
+#endif
+  esp_deep_sleep_start();
+}
+
+void networkStep()
+{
+  // A check-in only brings the network up if its sample is due to be sent.
+  if (boot.checkIn && !boot.networkStarted)
+  {
+    SampleRecord next;
+    if (!sampleQueue.peek(next))
+      return;
+#if TELEMETRY_JOURNAL
+    bool backlog = journal.pending() > 0;
+#else
+    bool backlog = false;
+#endif
+    if (next.kind == SampleRecord::SAMPLE && !frameDue(next.sample) && !backlog)
     {
-      Serial.printf("Temperature: %.2f °C\n", temp);
-      Serial.printf("Humidity: %.2f %%\n", hum);
-      publishSensorData(temp, hum);
+      LOG_INFO("[WAKE] Nothing due, back to sleep\n");
+      enterDeepSleep();
     }
-    else
+    startNetwork();
+  }
+
+  // never blocks for long: a dead network only delays the records queued here
+  if (boot.networkStarted)
+  {
+    connection.loop();
+    if (connection.connected())
     {
-      Serial.println("DHT sensor read failed!");
+      StageTimer timer(mqttLoopStats);
+      client.loop();
     }
+  }
+#if TELEMETRY_JOURNAL
+  livePublished = false;
+#endif
+
+  size_t depth = sampleQueue.size();
+  if (depth > sampleQueueHighWater)
+    sampleQueueHighWater = depth;
+  // after a wake, records wait for the broker so they go out live
+  bool hold = boot.wakeCause != ESP_SLEEP_WAKEUP_UNDEFINED && !connection.connected() && millis() < wakeConnectTimeout;
+  SampleRecord record;
+  while (!hold && sampleQueue.pop(record))
+    handleRecord(record);
+
+#if TELEMETRY_JOURNAL
+  if (connection.connected())
+    replayJournal();
+  bool drained = journal.pending() == 0;
+#else
+  bool drained = true;
+#endif
+
+  if (alertConfigAckPending && connection.connected())
+    publishAlertConfig();
+  if (alertConfigDirty && millis() - alertConfigChangedAt >= alertConfigSaveDelay)
+    saveAlertConfig();
+
+#if DIAGNOSTICS_INTERVAL_MS > 0
+  // a check-in is too short to be worth a report
+  if (connection.connected() && !boot.checkIn && millis() - lastDiagnostics >= DIAGNOSTICS_INTERVAL_MS)
+    publishDiagnostics();
+#endif
+
+  if (boot.sleepPending && buttonReleased())
+    enterDeepSleep();
+  if (boot.checkIn && boot.checkInSampleHandled && (drained || !connection.connected() || millis() >= checkInDeadline))
+    enterDeepSleep();
+}
+
+#if DUAL_CORE_TASKS
+// Fixed-rate: the next wake-up is scheduled from the previous one, not from
+// when the step finished.
+void acquisitionTask(void *)
+{
+  TickType_t lastWake = xTaskGetTickCount();
+  for (;;)
+  {
+    acquisitionStep();
+    vTaskDelayUntil(&lastWake, acquisitionPeriod);
+  }
+}
+
+void networkTask(void *)
+{
+  for (;;)
+  {
+    networkStep();
+    vTaskDelay(networkPeriod);
+  }
+}
+#endif
+
+// Restores what a deep sleep kept in RTC memory. Both wake-ups take their
+// first sample after a short IMU window instead of a full sampling period.
+void resumeFromSleep()
+{
+  wakeCount++;
+  ledState = sleptLedState;
+  connection.restoreCache(connectionCache);
+  sampling.resumeAt(millis(), wakeSampleWindow);
+  lastFrameMs = millis() - lastFrameAgeMs;
+
+  if (boot.wakeCause == ESP_SLEEP_WAKEUP_TIMER)
+  {
+    boot.checkIn = true;
+    lastFrameMs -= (unsigned long)SLEEP_TIMER_WAKE_S * 1000;
+    if (haveLastFrame)
+      markFrameReported(lastFrame, lastFrameMs);
+  }
+  else
+  {
+    frameReport = ReportChannels(); // a button wake reports a full frame at once
+#if !BUTTON_INTERRUPT
+    lastButtonState = LOW; // the press that woke us is not a new sleep request
+#endif
+    SampleRecord record = {};
+    record.kind = SampleRecord::BUTTON;
+    record.sleepMode = false;
+    sampleQueue.push(record);
+  }
+}
 
-    Serial.printf("Accel: X=%d Y=%d Z=%d\n", AcX, AcY, AcZ);
-    Serial.printf("Gyro: X=%d Y=%d Z=%d\n", GyX, GyY, GyZ);
-    publishMotionData();
-    publishAlerts();
-    Serial.printf("LED Remote State: %s\n", ledState ? "ON" : "OFF");
-    Serial.println("=========================\n");
+void setup()
+{
+  Serial.begin(115200);
+  pinMode(LED_PIN, OUTPUT);
+  pinMode(BUTTON_PIN, INPUT_PULLUP);
+#if DHT_ASYNC_READER
+  dhtReader.begin();
+#else
+  dht.begin();
+#endif
+  setup_mpu();
+  motionPending = false;
+#if BUTTON_INTERRUPT
+  buttonSettling = false;
+  buttonDown = digitalRead(BUTTON_PIN) == LOW; // a button wake is still held
+  attachInterrupt(digitalPinToInterrupt(BUTTON_PIN), onButtonEdge, CHANGE);
+#endif
+#if MPU_MOTION_INTERRUPT
+  pinMode(MPU_INT_PIN, INPUT); // driven push-pull by the MPU6050
+  attachInterrupt(digitalPinToInterrupt(MPU_INT_PIN), onMotionInterrupt, RISING);
+#endif
+#if TELEMETRY_JOURNAL
+  if (!journal.begin("journal")) // 64 KB: ~1400 frames, ~115 min at 5 s
+    LOG_ERROR("Failed to open telemetry journal!\n");
+#endif
+  client.setBufferSize(512); // replay batches and the diagnostics message
+  client.setServer(mqtt_server, 1883);
+  client.setCallback(mqttCallback);
+  connection.onConnect(onMqttConnected);
+  uint8_t mac[6];
+  WiFi.macAddress(mac); // factory MAC, readable before Wi-Fi starts
+  snprintf(deviceTopicPrefix, sizeof(deviceTopicPrefix), "devices/%02x%02x%02x%02x%02x%02x", mac[0], mac[1], mac[2],
+           mac[3], mac[4], mac[5]);
+  lastDiagnostics = millis();
+
+  boot = BootState();
+  sampling.resetSampling();
+  resetAlerts();
+  boot.wakeCause = esp_sleep_get_wakeup_cause();
+  if (boot.wakeCause == ESP_SLEEP_WAKEUP_EXT0 || boot.wakeCause == ESP_SLEEP_WAKEUP_TIMER)
+    resumeFromSleep();
+  else
+  {
+    boot.wakeCause = ESP_SLEEP_WAKEUP_UNDEFINED; // power-on or reset
+    sampling.resetDetectors(); // RTC memory survives a reset
   }
+  if (!boot.checkIn)
+    startNetwork();
+#if DUAL_CORE_TASKS
+  // acquisition outranks networking so it preempts it if they ever share a core
+  xTaskCreatePinnedToCore(acquisitionTask, "acquisition", 4096, nullptr, 3, nullptr, ACQUISITION_CORE);
+  xTaskCreatePinnedToCore(networkTask, "network", 8192, nullptr, 2, nullptr, NETWORK_CORE);
+#endif
+}
+
+void loop()
+{
+#if DUAL_CORE_TASKS
+  vTaskDelete(NULL); // everything runs in the two tasks
+#else
+  acquisitionStep();
+  networkStep();
+#endif
 }
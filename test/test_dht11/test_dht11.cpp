@@ -0,0 +1,144 @@
+// decodeDht11 on the recorded answers in bench/traces/dht11_edges.txt: three
+// good frames, then a checksum error, a sensor that stops mid-frame and a
+// glitch on the line. Run from the project directory: pio test -e native
+
+#include <unity.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include <Dht11Reader.h>
+
+namespace
+{
+  const char *EDGE_FILE = "bench/traces/dht11_edges.txt";
+
+  enum Line
+  {
+    OK_41_234,
+    OK_41_235,
+    CHECKSUM_BIT13,
+    TIMEOUT_24_BITS,
+    GLITCH_BIT8,
+    OK_42_236,
+    LINES
+  };
+
+  std::vector<std::vector<uint32_t>> transactions;
+
+  // Falling-edge times in us, one transaction per line, '#' comments (the
+  // bench's --dht-edges format).
+  bool loadEdges(const char *path)
+  {
+    FILE *f = fopen(path, "r");
+    if (!f)
+      return false;
+    char line[1024];
+    while (fgets(line, sizeof(line), f))
+    {
+      if (line[0] == '#' || line[0] == '\n' || line[0] == '\r')
+        continue;
+      std::vector<uint32_t> edges;
+      char *end;
+      for (char *p = line;; p = end)
+      {
+        unsigned long us = strtoul(p, &end, 10);
+        if (end == p)
+          break;
+        edges.push_back((uint32_t)us);
+      }
+      transactions.push_back(edges);
+    }
+    fclose(f);
+    return true;
+  }
+
+  Dht11Status decode(const std::vector<uint32_t> &edges, Dht11Reading &out)
+  {
+    return decodeDht11(edges.data(), edges.size(), out);
+  }
+
+  void assertReading(Line line, float humidity, float temperature)
+  {
+    Dht11Reading reading = {};
+    TEST_ASSERT_EQUAL(DHT11_OK, decode(transactions[line], reading));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, humidity, reading.humidity);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, temperature, reading.temperature);
+  }
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_edge_file_loads()
+{
+  TEST_ASSERT_EQUAL(LINES, transactions.size());
+}
+
+void test_good_frames()
+{
+  assertReading(OK_41_234, 41, 23.4f);
+  assertReading(OK_41_235, 41, 23.5f);
+  assertReading(OK_42_236, 42, 23.6f);
+}
+
+void test_checksum_error()
+{
+  Dht11Reading reading = {};
+  TEST_ASSERT_EQUAL(DHT11_CHECKSUM, decode(transactions[CHECKSUM_BIT13], reading));
+}
+
+void test_sensor_stops_mid_frame()
+{
+  Dht11Reading reading = {};
+  TEST_ASSERT_EQUAL(26, transactions[TIMEOUT_24_BITS].size()); // response + 24 bits + 1
+  TEST_ASSERT_EQUAL(DHT11_TIMEOUT, decode(transactions[TIMEOUT_24_BITS], reading));
+  // a good frame cut one edge short is a timeout too
+  TEST_ASSERT_EQUAL(DHT11_TIMEOUT, decodeDht11(transactions[OK_41_234].data(), DHT11_FRAME_EDGES - 1, reading));
+}
+
+void test_glitch_is_bad_pulse()
+{
+  Dht11Reading reading = {};
+  TEST_ASSERT_EQUAL(DHT11_BAD_PULSE, decode(transactions[GLITCH_BIT8], reading));
+}
+
+void test_any_epoch()
+{
+  // timestamps are micros(): the capture may straddle its wrap
+  std::vector<uint32_t> edges = transactions[OK_41_235];
+  for (uint32_t &us : edges)
+    us += 0xFFFFF000u;
+  Dht11Reading reading = {};
+  TEST_ASSERT_EQUAL(DHT11_OK, decode(edges, reading));
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 23.5f, reading.temperature);
+}
+
+void test_edges_past_frame_ignored()
+{
+  std::vector<uint32_t> edges = transactions[OK_42_236];
+  edges.push_back(edges.back() + 5); // line noise after the end of the frame
+  edges.push_back(edges.back() + 5);
+  Dht11Reading reading = {};
+  TEST_ASSERT_EQUAL(DHT11_OK, decode(edges, reading));
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 42, reading.humidity);
+}
+
+int main()
+{
+  if (!loadEdges(EDGE_FILE))
+  {
+    fprintf(stderr, "cannot open %s\n", EDGE_FILE);
+    return 1;
+  }
+  UNITY_BEGIN();
+  RUN_TEST(test_edge_file_loads);
+  RUN_TEST(test_good_frames);
+  RUN_TEST(test_checksum_error);
+  RUN_TEST(test_sensor_stops_mid_frame);
+  RUN_TEST(test_glitch_is_bad_pulse);
+  RUN_TEST(test_any_epoch);
+  RUN_TEST(test_edges_past_frame_ignored);
+  return UNITY_END();
+}
@@ -0,0 +1,141 @@
+// FIFO parsing and window features on the recorded knock in
+// bench/traces/knock_fifo.hex (1 s at 500 Hz, board flat, a knock at 400 ms).
+// Run from the project directory: pio test -e native
+
+#include <unity.h>
+
+#include <stdio.h>
+#include <vector>
+
+#include <MotionFeatures.h>
+#include <Mpu6050Fifo.h>
+
+namespace
+{
+  const char *KNOCK_DUMP = "bench/traces/knock_fifo.hex";
+  const size_t KNOCK_RECORDS = 500;
+  const size_t FIRST_WINDOW = 206; // what the firmware's first window drains
+  const uint16_t KNOCK_PEAK = 25379;
+  const uint16_t BURST_RECORDS = 10; // as Mpu6050Fifo::drain() reads them
+
+  std::vector<uint8_t> dump;
+
+  // Hex bytes, whitespace ignored, '#' comment lines (the bench's format).
+  bool loadDump(const char *path, std::vector<uint8_t> &bytes)
+  {
+    FILE *f = fopen(path, "r");
+    if (!f)
+      return false;
+    char line[256];
+    while (fgets(line, sizeof(line), f))
+    {
+      if (line[0] == '#')
+        continue;
+      unsigned value;
+      int used;
+      for (const char *p = line; sscanf(p, " %2x%n", &value, &used) == 1; p += used)
+        bytes.push_back((uint8_t)value);
+    }
+    fclose(f);
+    return true;
+  }
+
+  // Feeds records [from, to) of the dump through the ring in drain-sized
+  // bursts, emptying the ring into the window after each.
+  void feed(MotionWindow &window, size_t from, size_t to)
+  {
+    ImuRing ring;
+    for (size_t r = from; r < to; r += BURST_RECORDS)
+    {
+      size_t records = to - r < BURST_RECORDS ? to - r : BURST_RECORDS;
+      parseFifoRecords(dump.data() + r * MPU_FIFO_RECORD_SIZE, records * MPU_FIFO_RECORD_SIZE, ring);
+      ImuSample sample;
+      while (ring.pop(sample))
+        window.add(sample);
+    }
+  }
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_dump_loads()
+{
+  TEST_ASSERT_EQUAL(KNOCK_RECORDS * MPU_FIFO_RECORD_SIZE, dump.size());
+}
+
+void test_parse_is_big_endian()
+{
+  ImuRing ring;
+  TEST_ASSERT_EQUAL(1, parseFifoRecords(dump.data(), MPU_FIFO_RECORD_SIZE, ring));
+  ImuSample sample;
+  TEST_ASSERT_TRUE(ring.pop(sample));
+  // first line: 0079 ff9b 4006 0005 fff2 fff3
+  const int16_t expected[6] = {0x79, -101, 0x4006, 5, -14, -13};
+  const int16_t actual[6] = {sample.accel[0], sample.accel[1], sample.accel[2],
+                             sample.gyro[0], sample.gyro[1], sample.gyro[2]};
+  TEST_ASSERT_EQUAL_INT16_ARRAY(expected, actual, 6);
+}
+
+void test_parse_ignores_partial_record()
+{
+  ImuRing ring;
+  TEST_ASSERT_EQUAL(3, parseFifoRecords(dump.data(), 3 * MPU_FIFO_RECORD_SIZE + 7, ring));
+  TEST_ASSERT_EQUAL(3, ring.size());
+}
+
+void test_parse_counts_ring_overflow()
+{
+  ImuRing ring;
+  TEST_ASSERT_EQUAL(KNOCK_RECORDS, parseFifoRecords(dump.data(), dump.size(), ring));
+  TEST_ASSERT_EQUAL(ImuRing::capacity(), ring.size());
+  TEST_ASSERT_EQUAL(KNOCK_RECORDS - ImuRing::capacity(), ring.drops());
+}
+
+void test_knock_window_peak()
+{
+  MotionWindow window;
+  MotionFeatures features;
+  feed(window, 0, FIRST_WINDOW);
+  window.finish(features);
+  TEST_ASSERT_EQUAL(FIRST_WINDOW, features.samples);
+  TEST_ASSERT_EQUAL_UINT16(KNOCK_PEAK, features.accelPeakMagnitude);
+  // ~1 g at rest on Z, 16384 counts
+  TEST_ASSERT_LESS_THAN(17000, features.accelRmsMagnitude);
+  TEST_ASSERT_GREATER_THAN(16000, features.accelRmsMagnitude);
+  // the knock above gravity, far beyond the motion detector's floor
+  TEST_ASSERT_GREATER_THAN(8000, features.dynamicPeakMagnitude);
+}
+
+void test_quiet_window_after_knock()
+{
+  MotionWindow window;
+  MotionFeatures features;
+  feed(window, 0, FIRST_WINDOW);
+  window.finish(features);
+  feed(window, FIRST_WINDOW, 250); // the ringing, ~30 ms
+  window.finish(features);
+  feed(window, 250, KNOCK_RECORDS);
+  window.finish(features);
+  TEST_ASSERT_EQUAL(KNOCK_RECORDS - 250, features.samples);
+  TEST_ASSERT_LESS_THAN(KNOCK_PEAK, features.accelPeakMagnitude);
+  // the gravity estimate carried over: only noise is left
+  TEST_ASSERT_LESS_THAN(200, features.dynamicPeakMagnitude);
+}
+
+int main()
+{
+  if (!loadDump(KNOCK_DUMP, dump))
+  {
+    fprintf(stderr, "cannot open %s\n", KNOCK_DUMP);
+    return 1;
+  }
+  UNITY_BEGIN();
+  RUN_TEST(test_dump_loads);
+  RUN_TEST(test_parse_is_big_endian);
+  RUN_TEST(test_parse_ignores_partial_record);
+  RUN_TEST(test_parse_counts_ring_overflow);
+  RUN_TEST(test_knock_window_peak);
+  RUN_TEST(test_quiet_window_after_knock);
+  return UNITY_END();
+}
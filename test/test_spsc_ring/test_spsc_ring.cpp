@@ -0,0 +1,156 @@
+// SpscRing between two real threads, as between the acquisition and network
+// tasks on the two cores: every item arrives once, in order and whole.
+
+#include <unity.h>
+
+#include <atomic>
+#include <stdint.h>
+#include <thread>
+
+#include <SpscRing.h>
+
+namespace
+{
+  const uint32_t ITEMS = 1000000;
+
+  // Wider than a machine word, so a torn copy shows up as a mismatch.
+  struct Record
+  {
+    uint32_t seq;
+    uint32_t check[5];
+  };
+
+  Record makeRecord(uint32_t seq)
+  {
+    Record r;
+    r.seq = seq;
+    for (uint32_t i = 0; i < 5; i++)
+      r.check[i] = seq * 2654435761u + i;
+    return r;
+  }
+
+  bool intact(const Record &r)
+  {
+    for (uint32_t i = 0; i < 5; i++)
+      if (r.check[i] != r.seq * 2654435761u + i)
+        return false;
+    return true;
+  }
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_single_thread_fifo_and_full()
+{
+  SpscRing<uint32_t, 4> ring;
+  TEST_ASSERT_EQUAL(3, ring.capacity());
+  for (uint32_t i = 0; i < 3; i++)
+    TEST_ASSERT_TRUE(ring.push(i));
+  TEST_ASSERT_FALSE(ring.push(99));
+  TEST_ASSERT_EQUAL(1, ring.drops());
+  TEST_ASSERT_EQUAL(3, ring.size());
+
+  uint32_t item;
+  TEST_ASSERT_TRUE(ring.peek(item));
+  TEST_ASSERT_EQUAL(0, item);
+  for (uint32_t i = 0; i < 3; i++)
+  {
+    TEST_ASSERT_TRUE(ring.pop(item));
+    TEST_ASSERT_EQUAL(i, item);
+  }
+  TEST_ASSERT_FALSE(ring.pop(item));
+  TEST_ASSERT_EQUAL(0, ring.size());
+}
+
+void test_two_threads_lossless()
+{
+  static SpscRing<Record, 64> ring;
+  uint32_t fullRetries = 0;
+  std::thread producer([&] {
+    for (uint32_t seq = 0; seq < ITEMS; seq++)
+    {
+      Record r = makeRecord(seq);
+      while (!ring.push(r))
+      {
+        fullRetries++;
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  uint32_t expected = 0;
+  uint32_t outOfOrder = 0;
+  uint32_t torn = 0;
+  while (expected < ITEMS)
+  {
+    Record r;
+    if (!ring.pop(r))
+    {
+      std::this_thread::yield();
+      continue;
+    }
+    if (r.seq != expected)
+      outOfOrder++;
+    if (!intact(r))
+      torn++;
+    expected = r.seq + 1;
+  }
+  producer.join();
+
+  TEST_ASSERT_EQUAL(0, outOfOrder);
+  TEST_ASSERT_EQUAL(0, torn);
+  TEST_ASSERT_EQUAL(0, ring.size());
+  // every refused push was retried and counted as a drop by the ring
+  TEST_ASSERT_EQUAL(fullRetries, ring.drops());
+}
+
+void test_two_threads_drops_accounted()
+{
+  // The acquisition task never waits: what does not fit is dropped, and
+  // received + dropped must add up.
+  static SpscRing<uint32_t, 16> ring;
+  std::atomic<uint32_t> refused{0};
+  std::thread producer([&] {
+    for (uint32_t seq = 0; seq < ITEMS; seq++)
+      if (!ring.push(seq))
+        refused++;
+  });
+
+  uint32_t received = 0;
+  uint32_t last = 0;
+  bool ordered = true;
+  bool done = false;
+  while (!done)
+  {
+    uint32_t seq;
+    if (ring.pop(seq))
+    {
+      ordered = ordered && (received == 0 || seq > last);
+      last = seq;
+      received++;
+      done = seq == ITEMS - 1;
+    }
+    else if (received + refused == ITEMS)
+    {
+      done = true; // the last item itself was dropped
+    }
+  }
+  producer.join();
+  uint32_t item;
+  while (ring.pop(item))
+    received++;
+
+  TEST_ASSERT_TRUE(ordered);
+  TEST_ASSERT_EQUAL(refused, ring.drops());
+  TEST_ASSERT_EQUAL(ITEMS, received + refused);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_single_thread_fifo_and_full);
+  RUN_TEST(test_two_threads_lossless);
+  RUN_TEST(test_two_threads_drops_accounted);
+  return UNITY_END();
+}